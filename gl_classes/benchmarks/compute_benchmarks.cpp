@@ -0,0 +1,283 @@
+// Correctness tests and throughput benchmarks of the compute programs.
+//
+//      gl_classes_benchmarks            benchmark 1K to 100M items
+//      gl_classes_benchmarks --test     only check small sizes, for ctest
+//      gl_classes_benchmarks --max-items 10000000 --repetitions 10
+//
+// Every run is checked against a CPU reference, the exit code is 1 if any
+// check failed. Times are the median over the repetitions of the wall time
+// from issuing the commands until glFinish returns.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gl_classes/imgui_gl.h"
+#include "gl_classes/device_buffer.h"
+#include "gl_classes/compute_programs/scan_program.h"
+#include "gl_classes/compute_programs/radix_sort_program.h"
+
+using namespace gl_classes;
+using namespace gl_classes::compute_programs;
+
+namespace {
+
+    struct Options
+    {
+        std::vector<uint64_t> sizes;
+        int repetitions = 5;
+    };
+
+    /**
+     * Buffers shared by all benchmarks, so the largest size is allocated
+     * once. DeviceBuffer does not delete its buffer object.
+     */
+    struct Buffers
+    {
+        DeviceBuffer<uint32_t> source = DeviceBuffer<uint32_t>(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_COPY);
+        DeviceBuffer<uint32_t> keys = DeviceBuffer<uint32_t>(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_COPY);
+        DeviceBuffer<uint32_t> indices = DeviceBuffer<uint32_t>(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_COPY);
+        DeviceBuffer<uint32_t> payload = DeviceBuffer<uint32_t>(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_COPY);
+
+        void init()
+        {
+            source.init();
+            keys.init();
+            indices.init();
+            payload.init();
+        }
+        void resize(size_t numItems)
+        {
+            source.resize(numItems);
+            keys.resize(numItems);
+            indices.resize(numItems);
+            payload.resize(numItems);
+        }
+    };
+
+    int g_failures = 0;
+
+    void report(const char* name, const char* type, uint64_t numItems, double ms, bool ok)
+    {
+        double itemsPerSecond = (ms > 0) ? numItems / (ms / 1000.0) : 0.0;
+        printf("%-16s %-12s %10llu %10.3f ms %10.1f M items/s  %s\n",
+            name, type, static_cast<unsigned long long>(numItems), ms, itemsPerSecond / 1e6, ok ? "ok" : "FAIL");
+        fflush(stdout);
+        if (!ok) ++g_failures;
+    }
+
+    /**
+     * @brief      Median time in milliseconds until the commands issued by
+     *             run finished, prepare is issued before each run and not
+     *             timed.
+     */
+    template <typename prepare_t, typename run_t>
+    double gpuMilliseconds(int repetitions, prepare_t prepare, run_t run)
+    {
+        std::vector<double> times;
+        for (int i = 0; i < repetitions; ++i)
+        {
+            prepare();
+            glFinish();
+            auto start = std::chrono::steady_clock::now();
+            run();
+            glFinish();
+            times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+        std::sort(times.begin(), times.end());
+        return times[times.size() / 2];
+    }
+
+    void copyBuffer(GLuint src, GLuint dst, size_t numBytes)
+    {
+        glBindBuffer(GL_COPY_READ_BUFFER, src);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, dst);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, numBytes);
+    }
+
+    template <typename value_t>
+    std::vector<value_t> download(DeviceBuffer<value_t>& buffer, size_t numItems)
+    {
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+        std::vector<value_t> values(numItems);
+        buffer.bind().download(values.data(), 0, numItems);
+        return values;
+    }
+
+    void benchmarkScan(const Options& options, Buffers& buffers, std::mt19937& rng)
+    {
+        DeviceBuffer<uint32_t>& input = buffers.source;
+        DeviceBuffer<uint32_t>& output = buffers.keys;
+        ScanProgram<uint32_t> scan;
+        scan.setup();
+        for (uint64_t numItems : options.sizes)
+        {
+            std::vector<uint32_t> values(numItems);
+            for (uint32_t& value : values) value = rng() % 16;
+            buffers.resize(numItems);
+            input.bind().upload(values.data());
+
+            std::vector<uint32_t> inclusive(numItems);
+            std::partial_sum(values.begin(), values.end(), inclusive.begin());
+            std::vector<uint32_t> exclusive(numItems);
+            for (uint64_t i = 0; i < numItems; ++i) exclusive[i] = inclusive[i] - values[i];
+
+            for (bool isInclusive : {true, false})
+            {
+                scan.inclusive(isInclusive);
+                input.bufferBase(0);
+                output.bufferBase(1);
+                scan.use();
+                double ms = gpuMilliseconds(options.repetitions, [](){}, [&](){
+                    scan.dispatch(static_cast<uint32_t>(numItems), 0, 0);
+                });
+                bool ok = download(output, numItems) == (isInclusive ? inclusive : exclusive);
+                report(isInclusive ? "scan inclusive" : "scan exclusive", "uint", numItems, ms, ok);
+            }
+        }
+    }
+
+    template <typename key_t>
+    std::vector<key_t> randomKeys(size_t numItems, std::mt19937& rng);
+
+    template <>
+    std::vector<uint32_t> randomKeys<uint32_t>(size_t numItems, std::mt19937& rng)
+    {
+        std::vector<uint32_t> keys(numItems);
+        for (uint32_t& key : keys) key = rng();
+        return keys;
+    }
+    template <>
+    std::vector<int32_t> randomKeys<int32_t>(size_t numItems, std::mt19937& rng)
+    {
+        std::vector<int32_t> keys(numItems);
+        for (int32_t& key : keys) key = static_cast<int32_t>(rng());
+        return keys;
+    }
+    template <>
+    std::vector<float> randomKeys<float>(size_t numItems, std::mt19937& rng)
+    {
+        std::uniform_real_distribution<float> distribution(-1e6f, 1e6f);
+        std::vector<float> keys(numItems);
+        for (float& key : keys) key = distribution(rng);
+        return keys;
+    }
+
+    /**
+     * The keys are uploaded as raw 4 byte values. sort is set up again for
+     * each key type, so its temporary buffers are shared.
+     */
+    template <typename key_t>
+    void benchmarkRadixSort(const Options& options, Buffers& buffers, RadixSortProgram& sort, std::mt19937& rng, bool withPayload)
+    {
+        DeviceBuffer<uint32_t>& source = buffers.source;
+        DeviceBuffer<uint32_t>& keys = buffers.keys;
+        DeviceBuffer<uint32_t>& indices = buffers.indices;
+        DeviceBuffer<uint32_t>& payload = buffers.payload;
+        if (withPayload) sort.setup<key_t, uint32_t>();
+        else sort.setup<key_t>();
+        const char* name = withPayload ? "radix sort+idx" : "radix sort";
+
+        for (uint64_t numItems : options.sizes)
+        {
+            std::vector<key_t> values = randomKeys<key_t>(numItems, rng);
+            std::vector<uint32_t> sequence(numItems);
+            std::iota(sequence.begin(), sequence.end(), 0u);
+            buffers.resize(numItems);
+            source.bind().upload(values.data());
+            indices.bind().upload(sequence.data());
+
+            const size_t numBytes = sizeof(uint32_t) * numItems;
+            double ms = gpuMilliseconds(options.repetitions, [&](){
+                copyBuffer(source.bufferId(), keys.bufferId(), numBytes);
+                if (withPayload) copyBuffer(indices.bufferId(), payload.bufferId(), numBytes);
+            }, [&](){
+                sort.use();
+                if (withPayload) sort.dispatch(keys, payload, static_cast<uint32_t>(numItems));
+                else sort.dispatch(keys, static_cast<uint32_t>(numItems));
+            });
+
+            // stable reference, the payload must be the stable permutation
+            std::stable_sort(sequence.begin(), sequence.end(), [&](uint32_t a, uint32_t b) { return values[a] < values[b]; });
+            std::vector<key_t> expected(numItems);
+            for (uint64_t i = 0; i < numItems; ++i) expected[i] = values[sequence[i]];
+            std::vector<uint32_t> sortedBits = download(keys, numItems);
+            std::vector<key_t> sorted(numItems);
+            if (numItems > 0) std::memcpy(sorted.data(), sortedBits.data(), numBytes);
+            bool ok = (sorted == expected);
+            if (withPayload) ok = ok && (download(payload, numItems) == sequence);
+            report(name, glsl_type<key_t>::name(), numItems, ms, ok);
+        }
+    }
+
+    bool initContext()
+    {
+        if (!glfwInit()) return false;
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        GLFWwindow* window = glfwCreateWindow(64, 64, "gl_classes_benchmarks", NULL, NULL);
+        if (window == NULL) return false;
+        glfwMakeContextCurrent(window);
+        glewExperimental = GL_TRUE;
+        return glewInit() == GLEW_OK;
+    }
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    bool test = false;
+    uint64_t maxItems = 100000000;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--test") test = true;
+        else if ((arg == "--max-items") && (i + 1 < argc)) maxItems = std::strtoull(argv[++i], NULL, 10);
+        else if ((arg == "--repetitions") && (i + 1 < argc)) options.repetitions = std::max(1, std::atoi(argv[++i]));
+        else
+        {
+            printf("usage: %s [--test] [--max-items N] [--repetitions N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (test)
+    {
+        // block boundaries and multiple scan levels
+        options.sizes = {1, 1000, 1024, 1025, 100000, 3000000};
+        options.repetitions = 1;
+    }
+    else
+    {
+        for (uint64_t numItems = 1000; numItems <= maxItems; numItems *= 10) options.sizes.push_back(numItems);
+    }
+    if (!initContext())
+    {
+        printf("could not create an OpenGL 4.5 context\n");
+        return 1;
+    }
+    printf("%s\n", glGetString(GL_RENDERER));
+
+    std::mt19937 rng(1);
+    Buffers buffers;
+    buffers.init();
+    benchmarkScan(options, buffers, rng);
+    RadixSortProgram sort;
+    for (bool withPayload : {false, true})
+    {
+        benchmarkRadixSort<uint32_t>(options, buffers, sort, rng, withPayload);
+        benchmarkRadixSort<int32_t>(options, buffers, sort, rng, withPayload);
+        benchmarkRadixSort<float>(options, buffers, sort, rng, withPayload);
+    }
+    printf("%d failed\n", g_failures);
+    glfwTerminate();
+    return (g_failures == 0) ? 0 : 1;
+}
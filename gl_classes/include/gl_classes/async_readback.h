@@ -0,0 +1,151 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <cstdint>
+#include "gl_classes/imgui_gl.h"
+#include "gl_classes/device_buffer.h"
+
+namespace gl_classes {
+
+    /**
+     * @brief      Reads buffers back to the host without stalling the
+     *             pipeline.
+     *
+     * read() copies the range with glCopyBufferSubData into a persistently
+     * mapped staging buffer and places a fence behind the copy. The returned
+     * Request is polled with ready() or waited on with wait(). When the
+     * fence is signaled the data is copied into the destination. poll()
+     * completes all finished requests, call it once per frame. Staging
+     * buffers are pooled and reused once their request completed.
+     *
+     *      AsyncReadback readback;
+     *      auto request = readback.download(compacted); // HostDeviceBuffer
+     *      ...
+     *      if (request.ready()) use(compacted.buffer);
+     *
+     * Shader writes to the source need a GL_BUFFER_UPDATE_BARRIER_BIT
+     * barrier before read(). The destination must stay valid until the
+     * request completed.
+     */
+    class AsyncReadback
+    {
+    protected:
+        struct State;
+
+    public:
+        class Request
+        {
+        public:
+            Request() {}
+
+            /**
+             * @brief      Whether the data arrived in the destination, does
+             *             not block.
+             */
+            bool ready();
+            /**
+             * @brief      Block until the data arrived in the destination.
+             */
+            void wait();
+            bool valid() const { return m_state != nullptr; }
+            size_t numBytes() const;
+
+        protected:
+            friend class AsyncReadback;
+            Request(const std::shared_ptr<State>& state) : m_state(state) {}
+            std::shared_ptr<State> m_state;
+        };
+
+        struct Statistics
+        {
+            uint64_t requests = 0;
+            uint64_t bytes = 0;
+            uint64_t waits = 0;    // completions that had to block
+            size_t numStaging = 0;
+            size_t stagingBytes = 0;
+        };
+
+        /**
+         * @param[in]  minStagingSize  Minimal size of staging buffers in
+         *                             bytes
+         */
+        AsyncReadback(size_t minStagingSize = 64 * 1024);
+        ~AsyncReadback();
+        AsyncReadback(const AsyncReadback&) = delete;
+        AsyncReadback& operator=(const AsyncReadback&) = delete;
+
+        /**
+         * @brief      Read numBytes at offsetBytes of buffer into destination.
+         */
+        Request read(GLuint buffer, size_t offsetBytes, size_t numBytes, void* destination);
+
+        /**
+         * @brief      Read items start to start+num of a DeviceBuffer or
+         *             ArenaBuffer into destination.
+         */
+        template<typename buffer_t>
+        Request download(const buffer_t& buffer, void* destination, size_t start, size_t num)
+        {
+            return read(
+                buffer.bufferId(),
+                bufferOffsetBytes(buffer) + buffer_t::element_size * start,
+                buffer_t::element_size * num,
+                destination
+            );
+        }
+
+        /**
+         * @brief      Read all items of a HostDeviceBuffer into its buffer
+         *             vector, which is resized to size() now.
+         */
+        template<typename host_device_buffer_t>
+        Request download(host_device_buffer_t& buffer)
+        {
+            buffer.buffer.resize(buffer.size());
+            return download(buffer, buffer.buffer.data(), 0, buffer.size());
+        }
+
+        /**
+         * @brief      Complete all requests whose copy finished.
+         */
+        void poll();
+
+        /**
+         * @brief      Complete all requests, blocking.
+         */
+        void finish();
+
+        size_t numPending() const { return m_pending.size(); }
+        const Statistics& statistics() const { return m_statistics; }
+
+    protected:
+        struct Staging
+        {
+            GLuint buffer = 0;
+            size_t size = 0;
+            uint8_t* mapped = nullptr;
+            bool busy = false;
+        };
+        struct State
+        {
+            AsyncReadback* owner = nullptr;
+            GLsync fence = 0;
+            size_t staging = 0;
+            void* destination = nullptr;
+            size_t numBytes = 0;
+            bool complete = false;
+        };
+
+        size_t acquireStaging(size_t numBytes);
+        bool tryComplete(State& state, GLuint64 timeoutNs);
+        void complete(State& state);
+
+        size_t m_minStagingSize;
+        std::vector<Staging> m_staging;
+        std::deque<std::shared_ptr<State>> m_pending;
+        Statistics m_statistics;
+    };
+
+} // namespace gl_classes
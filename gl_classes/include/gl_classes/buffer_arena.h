@@ -0,0 +1,320 @@
+#pragma once
+
+#include <map>
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+#include "gl_classes/imgui_gl.h"
+
+namespace gl_classes {
+
+    /**
+     * @brief      Sub-allocates byte ranges of a few large buffer objects,
+     *             for many small buffers without one buffer object each.
+     *
+     * Each block is one buffer object with an address ordered free list.
+     * allocate() takes the first free range that fits, free() returns the
+     * range and merges it with its free neighbours. Offsets are aligned to
+     * the shader storage and uniform buffer offset alignments, so every
+     * allocation can be bound with glBindBufferRange. A new block is created
+     * when no free range fits.
+     *
+     * Use ArenaBuffer for typed allocations that behave like a DeviceBuffer.
+     *
+     * The arena must outlive its ArenaBuffers. Allocations outstanding when
+     * release() deletes their block become stale: free() ignores them and
+     * isCurrent() returns false for them, even when a new block reuses the
+     * gl buffer name.
+     */
+    class BufferArena
+    {
+    public:
+        struct Allocation
+        {
+            GLuint buffer = 0;
+            size_t block = 0;
+            size_t offset = 0; // in bytes
+            size_t size = 0;   // in bytes, multiple of alignment()
+            uint64_t generation = 0; // of the block, to detect stale allocations
+            bool valid() const { return size > 0; }
+        };
+
+        struct Statistics
+        {
+            size_t numBlocks = 0;
+            size_t numAllocations = 0;
+            size_t bytesReserved = 0;  // size of all blocks
+            size_t bytesAllocated = 0;
+            size_t bytesFree = 0;
+            size_t numFreeRanges = 0;
+            size_t largestFreeRange = 0;
+            /**
+             * @return     0 if all free bytes are in one range, approaching
+             *             1 the more they are split into small ranges.
+             */
+            double fragmentation() const
+            {
+                return (bytesFree == 0) ? 0.0 : 1.0 - static_cast<double>(largestFreeRange) / bytesFree;
+            }
+        };
+
+        /**
+         * @param[in]  target     The target used to bind the blocks
+         * @param[in]  usage      The usage passed to glBufferData
+         * @param[in]  blockSize  Size of each block in bytes, larger
+         *                        allocations get a block of their own size
+         */
+        BufferArena(GLenum target = GL_SHADER_STORAGE_BUFFER, GLenum usage = GL_DYNAMIC_COPY, size_t blockSize = 16 * 1024 * 1024);
+        ~BufferArena();
+        BufferArena(const BufferArena&) = delete;
+        BufferArena& operator=(const BufferArena&) = delete;
+
+        /**
+         * @brief      Query the offset alignment, call with a current context
+         *             before the first allocate.
+         */
+        void init();
+
+        /**
+         * @brief      Allocate numBytes, rounded up to alignment().
+         */
+        Allocation allocate(size_t numBytes);
+
+        /**
+         * @brief      Return an allocation to its block and reset it. Stale
+         *             allocations are only reset.
+         */
+        void free(Allocation& allocation);
+
+        /**
+         * @brief      Whether the block of allocation still exists, false
+         *             after release().
+         */
+        bool isCurrent(const Allocation& allocation) const;
+
+        /**
+         * @brief      Delete the trailing blocks without allocations.
+         */
+        void trim();
+
+        /**
+         * @brief      Delete all blocks. Outstanding allocations become
+         *             stale and lose their contents.
+         */
+        void release();
+
+        Statistics statistics() const;
+        void drawImGui() const;
+
+        GLenum target() const { return m_target; }
+        GLenum usage() const { return m_usage; }
+        size_t blockSize() const { return m_blockSize; }
+        size_t alignment() const { return m_alignment; }
+
+    protected:
+        struct Block
+        {
+            GLuint buffer = 0;
+            size_t size = 0;
+            size_t numAllocations = 0;
+            uint64_t generation = 0;
+            std::map<size_t, size_t> free; // offset -> size
+        };
+
+        bool allocateFrom(size_t blockIdx, size_t numBytes, Allocation& allocation);
+
+        GLenum m_target;
+        GLenum m_usage;
+        size_t m_blockSize;
+        size_t m_alignment;
+        uint64_t m_generation;
+        std::vector<Block> m_blocks;
+    };
+
+    /**
+     * @brief      Typed buffer in a BufferArena, with the interface of
+     *             DeviceBuffer used by compute programs and pipelines.
+     *
+     * bufferBase binds the range of the allocation with glBindBufferRange,
+     * so shaders index from the start of the allocation. upload, download
+     * and mapr are relative to the allocation and bind the block themselves.
+     * Growing moves the items to a new allocation and keeps the contents.
+     * offsetBytes() gives the start in the block, for example for vertex
+     * attribute offsets.
+     *
+     * Programs that bind buffer ids directly, like RadixSortProgram, need
+     * whole buffer objects. The arena must outlive the ArenaBuffer.
+     *
+     * @tparam     value_t  Value type
+     */
+    template <typename value_t>
+    class ArenaBuffer
+    {
+    public:
+        using value_type = value_t;
+        static constexpr size_t element_size = sizeof(value_type);
+
+        ArenaBuffer(BufferArena* arena = nullptr, size_t initialSize = 0)
+            : m_arena(arena)
+            , m_numItems(initialSize)
+            , m_bufferBase(0)
+        {}
+        ~ArenaBuffer()
+        {
+            release();
+        }
+        ArenaBuffer(const ArenaBuffer&) = delete;
+        ArenaBuffer& operator=(const ArenaBuffer&) = delete;
+        ArenaBuffer(ArenaBuffer&& other)
+            : m_arena(other.m_arena)
+            , m_allocation(other.m_allocation)
+            , m_numItems(other.m_numItems)
+            , m_bufferBase(other.m_bufferBase)
+        {
+            other.m_allocation = BufferArena::Allocation();
+            other.m_numItems = 0;
+        }
+        ArenaBuffer& operator=(ArenaBuffer&& other)
+        {
+            if (this != &other)
+            {
+                release();
+                m_arena = other.m_arena;
+                m_allocation = other.m_allocation;
+                m_numItems = other.m_numItems;
+                m_bufferBase = other.m_bufferBase;
+                other.m_allocation = BufferArena::Allocation();
+                other.m_numItems = 0;
+            }
+            return *this;
+        }
+
+        void init()
+        {
+            resize(m_numItems);
+        }
+        void init(BufferArena& arena, size_t numItems)
+        {
+            release();
+            m_arena = &arena;
+            resize(numItems);
+        }
+
+        /**
+         * @brief      Resize to numItems, moving to a larger allocation if
+         *             needed.
+         */
+        void resize(size_t numItems)
+        {
+            m_numItems = numItems;
+            reserve(numItems);
+        }
+        void reserve(size_t numItems)
+        {
+            size_t numBytes = element_size * numItems;
+            bool current = !m_allocation.valid() || m_arena->isCurrent(m_allocation);
+            if ((numBytes <= m_allocation.size) && current) return;
+            if (m_arena == nullptr)
+            {
+                throw std::runtime_error("ArenaBuffer without BufferArena");
+            }
+            BufferArena::Allocation allocation = m_arena->allocate(numBytes);
+            if (m_allocation.valid() && current)
+            {
+                glBindBuffer(GL_COPY_READ_BUFFER, m_allocation.buffer);
+                glBindBuffer(GL_COPY_WRITE_BUFFER, allocation.buffer);
+                glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, m_allocation.offset, allocation.offset, m_allocation.size);
+            }
+            m_arena->free(m_allocation);
+            m_allocation = allocation;
+        }
+        /**
+         * @brief      Return the allocation to the arena.
+         */
+        void release()
+        {
+            if (m_arena && m_allocation.valid()) m_arena->free(m_allocation);
+            m_allocation = BufferArena::Allocation();
+        }
+
+        size_t size() const { return m_numItems; }
+        size_t capacity() const { return m_allocation.size / element_size; }
+        size_t bufferSize() const { return m_allocation.size; }
+        GLenum target() const { return m_arena ? m_arena->target() : GL_SHADER_STORAGE_BUFFER; }
+        GLuint bufferId() const { return m_allocation.buffer; }
+        GLuint getBufferId() const { return m_allocation.buffer; }
+        size_t offsetBytes() const { return m_allocation.offset; }
+        size_t rangeBytes() const { return m_allocation.size; }
+        const BufferArena::Allocation& allocation() const { return m_allocation; }
+
+        ArenaBuffer<value_type>& bind()
+        {
+            glBindBuffer(target(), bufferId());
+            return *this;
+        }
+        const ArenaBuffer<value_type>& bind() const
+        {
+            glBindBuffer(target(), bufferId());
+            return *this;
+        }
+        ArenaBuffer<value_type>& upload(const void* data)
+        {
+            return upload(data, 0, m_numItems);
+        }
+        ArenaBuffer<value_type>& upload(const void* data, size_t start, size_t num)
+        {
+            bind();
+            glBufferSubData(target(), offsetBytes() + element_size*start, element_size*num, data);
+            return *this;
+        }
+        const ArenaBuffer<value_type>& download(void* data) const
+        {
+            return download(data, 0, m_numItems);
+        }
+        const ArenaBuffer<value_type>& download(void* data, size_t start, size_t num) const
+        {
+            bind();
+            glGetBufferSubData(target(), offsetBytes() + element_size*start, element_size*num, data);
+            return *this;
+        }
+
+        GLuint bufferBase() const
+        {
+            return m_bufferBase;
+        }
+        /**
+         * @brief      Bind the allocation with glBindBufferRange.
+         */
+        ArenaBuffer<value_type>& bufferBase(GLuint value)
+        {
+            cbufferBase(value);
+            m_bufferBase = value;
+            return *this;
+        }
+        const ArenaBuffer<value_type>& cbufferBase(GLuint value) const
+        {
+            glBindBufferRange(target(), value, bufferId(), offsetBytes(), rangeBytes());
+            return *this;
+        }
+
+        void* mapr_ro(size_t start, size_t num) { return mapr(start, num, GL_MAP_READ_BIT); }
+        void* mapr_wo(size_t start, size_t num) { return mapr(start, num, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT); }
+        void* mapr_rw(size_t start, size_t num) { return mapr(start, num, GL_MAP_READ_BIT | GL_MAP_WRITE_BIT); }
+        void* mapr(size_t start, size_t num, GLbitfield access)
+        {
+            bind();
+            return glMapBufferRange(target(), offsetBytes() + element_size*start, element_size*num, access);
+        }
+        void unmap()
+        {
+            glUnmapBuffer(target());
+        }
+
+    protected:
+        BufferArena* m_arena;
+        BufferArena::Allocation m_allocation;
+        size_t m_numItems;
+        GLuint m_bufferBase;
+    };
+
+} // namespace gl_classes
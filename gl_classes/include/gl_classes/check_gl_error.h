@@ -1,7 +1,66 @@
 #pragma once
 
+#include <string>
+
 namespace gl_classes {
 
+    /**
+     * @brief      When checkGLError() queries the driver.
+     *
+     *      policy   | checkGLError()            | checkGLErrorFrame()
+     *      ---------|---------------------------|-------------------------
+     *      Off      | nothing                   | nothing
+     *      PerFrame | nothing                   | glGetError + debug log
+     *      PerCall  | glGetError + debug log    | glGetError + debug log
+     *
+     * glGetError synchronizes with the driver on many implementations, so
+     * PerCall is the default only in debug builds.
+     */
+    enum class ErrorCheckPolicy
+    {
+        Off,
+        PerFrame,
+        PerCall
+    };
+
+    ErrorCheckPolicy errorCheckPolicy();
+
+    /**
+     * @brief      Set the error check policy. If a DebugMessageLog is
+     *             active, PerCall switches debug output to synchronous, so
+     *             messages are attributed to the right program.
+     */
+    void errorCheckPolicy(ErrorCheckPolicy policy);
+
+    /**
+     * @brief      Name of the program currently issuing gl commands, used to
+     *             tag errors and debug messages. Set by Program::use().
+     *
+     * Names are interned and published atomically, so the debug callback
+     * can read them from a driver thread when debug output is asynchronous.
+     * The returned string stays valid for the lifetime of the process.
+     * Under asynchronous output, the tag is the program current when the
+     * driver reports the message, which may be later than the call that
+     * caused it. Only PerCall makes the tags exact.
+     */
+    const char* errorContext();
+    void errorContext(const std::string& name);
+
+    /**
+     * @brief      Check for errors if the policy is PerCall; throws
+     *             std::runtime_error on error.
+     */
     void checkGLError();
 
+    /**
+     * @brief      Check for errors once per frame unless the policy is
+     *             Off; throws std::runtime_error on error.
+     */
+    void checkGLErrorFrame();
+
+    /**
+     * @brief      Check for errors regardless of the policy.
+     */
+    void checkGLErrorNow();
+
 } // namespace gl_classes
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <cstdint>
+#include "gl_classes/imgui_gl.h"
+#include "gl_classes/device_buffer.h"
+
+namespace gl_classes {
+
+    /**
+     * @brief      Ordered list of stages that declare the buffers they read
+     *             and write, run with the minimal memory barriers.
+     *
+     * Before each stage the buffers are bound with glBindBufferBase, or
+     * glBindBufferRange for buffers with an offset or range like ArenaBuffer
+     * and the current region of a PersistentRingBuffer, unless
+     * the same range is already bound at that binding by the pipeline.
+     * Writes are tracked per buffer object, so writing one ArenaBuffer
+     * conservatively orders reads of others in the same block.
+     * A barrier is issued only for buffers written by an earlier stage and
+     * only with the bits matching how the stage accesses them, for example
+     * GL_COMMAND_BARRIER_BIT for indirect commands. Each bit is issued at
+     * most once per write, as glMemoryBarrier applies to all prior writes.
+     *
+     *      ComputePipeline pipeline;
+     *      pipeline.add("copy", [&](){ copy.use(); copy.dispatch(n); })
+     *          .reads(GL_SHADER_STORAGE_BUFFER, 0, src)
+     *          .writes(GL_SHADER_STORAGE_BUFFER, 1, dst);
+     *      pipeline.add("draw", [&](){ ... })
+     *          .reads(ComputePipeline::VertexAttrib, dst);
+     *      pipeline.run();
+     *
+     * Programs binding internal buffers in their dispatch, for example
+     * ScanProgram at binding 2, overwrite bindings the pipeline does not
+     * see; declare them with clobbers().
+     */
+    class ComputePipeline
+    {
+    public:
+        /**
+         * @brief      How a stage uses a buffer besides indexed bindings,
+         *             determines the barrier bit.
+         */
+        enum Usage : GLbitfield
+        {
+            ShaderStorage = GL_SHADER_STORAGE_BARRIER_BIT,
+            Uniform = GL_UNIFORM_BARRIER_BIT,
+            AtomicCounter = GL_ATOMIC_COUNTER_BARRIER_BIT,
+            VertexAttrib = GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT,
+            ElementArray = GL_ELEMENT_ARRAY_BARRIER_BIT,
+            Command = GL_COMMAND_BARRIER_BIT,
+            BufferUpdate = GL_BUFFER_UPDATE_BARRIER_BIT, // glBufferSubData, glCopyBufferSubData, glGetBufferSubData
+            ClientMapped = GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT
+        };
+
+        struct BufferRange
+        {
+            GLuint buffer = 0;
+            size_t offset = 0; // in bytes
+            size_t size = 0;   // in bytes, 0 for the rest of the buffer
+            bool operator==(const BufferRange& other) const
+            {
+                return (buffer == other.buffer) && (offset == other.offset) && (size == other.size);
+            }
+        };
+
+        struct Access
+        {
+            std::function<GLuint()> buffer;
+            std::function<BufferRange()> range;
+            GLenum target;   // GL_NONE if not bound by the pipeline
+            GLuint binding;
+            GLbitfield usage;
+            bool write;
+        };
+
+        class Stage
+        {
+        public:
+            Stage(const std::string& name, std::function<void()> run)
+                : m_name(name), m_run(run)
+            {}
+
+            /**
+             * @brief      Bind buffer at binding of target and read it in
+             *             shaders.
+             */
+            template<typename buffer_t>
+            Stage& reads(GLenum target, GLuint binding, const buffer_t& buffer)
+            {
+                return access(target, binding, UsageOf(target), false, buffer);
+            }
+            template<typename buffer_t>
+            Stage& writes(GLenum target, GLuint binding, const buffer_t& buffer)
+            {
+                return access(target, binding, UsageOf(target), true, buffer);
+            }
+
+            /**
+             * @brief      Use a buffer without binding it by the pipeline, for
+             *             example as indirect commands or vertex attributes.
+             */
+            template<typename buffer_t>
+            Stage& reads(Usage usage, const buffer_t& buffer)
+            {
+                return access(GL_NONE, 0, usage, false, buffer);
+            }
+            template<typename buffer_t>
+            Stage& writes(Usage usage, const buffer_t& buffer)
+            {
+                return access(GL_NONE, 0, usage, true, buffer);
+            }
+
+            /**
+             * @brief      The stage changes the binding itself, it is bound
+             *             again by the next stage using it.
+             */
+            Stage& clobbers(GLenum target, GLuint binding)
+            {
+                m_clobbers.push_back(std::make_pair(target, binding));
+                return *this;
+            }
+
+            const std::string& name() const { return m_name; }
+            const std::vector<Access>& accesses() const { return m_accesses; }
+
+        protected:
+            friend class ComputePipeline;
+
+            template<typename buffer_t>
+            Stage& access(GLenum target, GLuint binding, GLbitfield usage, bool write, const buffer_t& buffer)
+            {
+                // the id is looked up when running, buffers may be resized in between
+                const buffer_t* ptr = &buffer;
+                Access item;
+                item.buffer = [ptr]() { return ptr->bufferId(); };
+                item.range = [ptr]() {
+                    BufferRange range;
+                    range.buffer = ptr->bufferId();
+                    range.offset = bufferOffsetBytes(*ptr);
+                    range.size = bufferRangeBytes(*ptr);
+                    return range;
+                };
+                item.target = target;
+                item.binding = binding;
+                item.usage = usage;
+                item.write = write;
+                m_accesses.push_back(item);
+                return *this;
+            }
+
+            std::string m_name;
+            std::function<void()> m_run;
+            std::vector<Access> m_accesses;
+            std::vector<std::pair<GLenum, GLuint>> m_clobbers;
+        };
+
+        struct Statistics
+        {
+            uint64_t runs = 0;
+            uint64_t barriers = 0;
+            uint64_t bindings = 0;
+            uint64_t skippedBindings = 0;
+        };
+
+        /**
+         * @brief      Append a stage; the returned reference is valid until
+         *             the next call to add.
+         */
+        Stage& add(const std::string& name, std::function<void()> run);
+
+        /**
+         * @brief      Run all stages in order.
+         */
+        void run();
+
+        /**
+         * @brief      Issue the barriers still needed for reading the buffers
+         *             written by the pipeline with the given usage bits, for
+         *             example BufferUpdate before a download.
+         */
+        void finish(GLbitfield usage);
+
+        /**
+         * @brief      Forget the known bindings, call when buffers were bound
+         *             outside of the pipeline.
+         */
+        void invalidateBindings();
+
+        std::vector<Stage>& stages() { return m_stages; }
+        const std::vector<Stage>& stages() const { return m_stages; }
+        const Statistics& statistics() const { return m_statistics; }
+        void resetStatistics() { m_statistics = Statistics(); }
+
+        static Usage UsageOf(GLenum target);
+
+    protected:
+        void barrier(GLbitfield bits);
+
+        std::vector<Stage> m_stages;
+        // written buffer -> barrier bits issued since the write
+        std::map<GLuint, GLbitfield> m_written;
+        std::map<std::pair<GLenum, GLuint>, BufferRange> m_bindings;
+        Statistics m_statistics;
+    };
+
+} // namespace gl_classes
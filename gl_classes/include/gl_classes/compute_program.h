@@ -6,6 +6,9 @@
 #include <cstdint>
 
 #include "gl_classes/program.h"
+#include "gl_classes/gpu_profiler.h"
+#include "gl_classes/indirect_commands.h"
+#include "gl_classes/device_buffer.h"
 
 namespace gl_classes {
 
@@ -13,6 +16,7 @@ namespace gl_classes {
     {
     public:
         ComputeProgram() : Program(){}
+        ComputeProgram(const std::string& name) : Program(name){}
         virtual ~ComputeProgram(){}
 
         virtual void dispatch(uint64_t x, uint64_t y, uint64_t z, uint32_t gx, uint32_t gy, uint32_t gz)
@@ -26,9 +30,75 @@ namespace gl_classes {
         
         virtual void dispatch(uint32_t x, uint32_t y, uint32_t z)
         {
+            ProgramUniformBase::Flush(getGlProgram());
+            GpuProfiler::Scope scope(getName());
             glDispatchCompute(x, y, z);
             checkGLError();
         }
+
+        /**
+         * @brief      Dispatch with the group counts read by the gpu from a
+         *             DispatchIndirectCommand, for example one written by
+         *             compute_programs::IndirectCommandProgram.
+         *
+         * @param[in]  indirectBuffer  Id of the buffer holding the commands
+         * @param[in]  offsetBytes     Byte offset of the command, multiple of 4
+         */
+        virtual void dispatchIndirect(GLuint indirectBuffer, GLintptr offsetBytes = 0)
+        {
+            ProgramUniformBase::Flush(getGlProgram());
+            GpuProfiler::Scope scope(getName());
+            glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, indirectBuffer);
+            glDispatchComputeIndirect(offsetBytes);
+            checkGLError();
+        }
+
+        /**
+         * @brief      Dispatch with the command at index of a buffer of
+         *             DispatchIndirectCommand, for example a DeviceBuffer
+         *             or ArenaBuffer. The buffer can have any target.
+         */
+        template<typename buffer_t>
+        void dispatchIndirect(const buffer_t& commands, size_t index = 0)
+        {
+            dispatchIndirect(
+                commands.bufferId(),
+                static_cast<GLintptr>(bufferOffsetBytes(commands) + index * sizeof(DispatchIndirectCommand))
+            );
+        }
+
+        /**
+         * @brief      Dispatch a linear number of work groups. Counts above
+         *             the guaranteed minimum of 65535 per dimension are
+         *             spread over y, so shaders must linearize gl_WorkGroupID
+         *             and skip excess groups.
+         */
+        void dispatchGroups(uint64_t num_groups)
+        {
+            const uint64_t max_x = 65535;
+            uint64_t gx = (num_groups < max_x) ? num_groups : max_x;
+            uint64_t gy = (gx == 0) ? 0 : (num_groups / gx + ((num_groups % gx == 0) ? 0 : 1));
+            ComputeProgram::dispatch(
+                static_cast<uint32_t>(gx),
+                static_cast<uint32_t>(gy),
+                1u
+            );
+        }
+
+        /**
+         * @brief      Number of value_t items a buffer needs to hold num items
+         *             of the matching glsl type in a std430 array. The glsl
+         *             array stride can be larger than sizeof(value_t), for
+         *             example 16 bytes for glm::vec3; it is bounded by the
+         *             next power of two.
+         */
+        template<typename value_t>
+        static size_t Std430Items(size_t num)
+        {
+            size_t stride = 1;
+            while (stride < sizeof(value_t)) stride <<= 1;
+            return (num * stride + sizeof(value_t) - 1) / sizeof(value_t);
+        }
     };
 
 } // namespace gl_classes
@@ -7,6 +7,7 @@
 #include "gl_classes/program_uniform.h"
 #include "gl_classes/compute_program.h"
 #include "gl_classes/shader.h"
+#include "gl_classes/glsl_type.h"
 
 namespace gl_classes {
 namespace compute_programs {
@@ -19,7 +20,7 @@ namespace compute_programs {
         using ComputeProgram = gl_classes::ComputeProgram;
         using Shader = gl_classes::Shader;
 
-        inline CopyIndirectInoutProgram(){}
+        inline CopyIndirectInoutProgram() : ComputeProgram("CopyIndirectInoutProgram") {}
         inline ~CopyIndirectInoutProgram(){}
         inline void setup(
             const std::string& indirection_type_str, 
@@ -32,20 +33,24 @@ namespace compute_programs {
             m_shaders[0].setup({
                 {"##INDIRECTION_TYPE##", indirection_type_str},
                 {"##DATA_TYPE##", data_type_str},
+                {"##TYPE_DECLARATIONS##", glslDeclarations({data_type_str})},
                 {"##GROUPSIZE_X##", std::to_string(m_group_size.x)},
                 {"##GROUPSIZE_Y##", std::to_string(m_group_size.y)},
                 {"##GROUPSIZE_Z##", std::to_string(m_group_size.z)},
             });
             Program::setup();
-            num_items.init(getGlProgram(), "num_items");
-            num_data.init(getGlProgram(), "num_data");
-            offset_in_data.init(getGlProgram(), "offset_in_data", 0);
-            offset_out_data.init(getGlProgram(), "offset_out_data", 0);
-            symmetric.init(getGlProgram(), "symmetric", false);
-            use_input_indirection.init(getGlProgram(), "use_input_indirection", true);
-            use_output_indirection.init(getGlProgram(), "use_output_indirection", true);
             checkGLError();
         }            
+        /**
+         * @brief      Setup for indices of indirection_t and buffers of
+         *             value_t, see glsl_type.
+         */
+        template<typename indirection_t, typename value_t>
+        inline void setup(glm::uvec3 group_size = glm::uvec3(1024,1,1))
+        {
+            static_assert(!glsl_type<indirection_t>::packed, "indirection type must be a glsl type");
+            setup(glsl_type<indirection_t>::name(), glsl_type<value_t>::storage_name(), group_size);
+        }
         inline void dispatch(uint32_t num_items, uint32_t num_data)
         {
             this->num_items.set(num_items);
@@ -63,6 +68,8 @@ namespace compute_programs {
         #define GROUPSIZE (GROUPSIZE_X*GROUPSIZE_Y*GROUPSIZE_Z)
         layout(local_size_x=GROUPSIZE_X, local_size_y=GROUPSIZE_Y, local_size_z=GROUPSIZE_Z) in;
 
+        ##TYPE_DECLARATIONS##
+
         layout (std430, binding = 0) buffer buf0 { ##INDIRECTION_TYPE## in_indirection[];  };
         layout (std430, binding = 1) buffer buf1 { ##INDIRECTION_TYPE## out_indirection[];  };
         layout (std430, binding = 2) buffer buf2 { ##DATA_TYPE## in_data[];  };
@@ -107,6 +114,17 @@ namespace compute_programs {
         ProgramUniform<bool> use_input_indirection;
         ProgramUniform<bool> use_output_indirection;
     protected:
+        void setupUniforms() override
+        {
+            num_items.init(getGlProgram(), "num_items");
+            num_data.init(getGlProgram(), "num_data");
+            offset_in_data.init(getGlProgram(), "offset_in_data", 0);
+            offset_out_data.init(getGlProgram(), "offset_out_data", 0);
+            symmetric.init(getGlProgram(), "symmetric", false);
+            use_input_indirection.init(getGlProgram(), "use_input_indirection", true);
+            use_output_indirection.init(getGlProgram(), "use_output_indirection", true);
+        }
+
         glm::uvec3 m_group_size;
     };
 
@@ -7,6 +7,8 @@
 #include "gl_classes/program_uniform.h"
 #include "gl_classes/compute_program.h"
 #include "gl_classes/shader.h"
+#include "gl_classes/glsl_type.h"
+#include "gl_classes/compute_programs/fused_program.h"
 
 namespace gl_classes {
 namespace compute_programs {
@@ -19,7 +21,7 @@ namespace compute_programs {
         using ComputeProgram = gl_classes::ComputeProgram;
         using Shader = gl_classes::Shader;
 
-        inline CopyIndirectProgram(){}
+        inline CopyIndirectProgram() : ComputeProgram("CopyIndirectProgram") {}
         inline ~CopyIndirectProgram(){}
         inline void setup(
             const std::string& indirection_type_str, 
@@ -32,15 +34,24 @@ namespace compute_programs {
             m_shaders[0].setup({
                 {"##INDIRECTION_TYPE##", indirection_type_str},
                 {"##DATA_TYPE##", data_type_str},
+                {"##TYPE_DECLARATIONS##", glslDeclarations({data_type_str})},
                 {"##GROUPSIZE_X##", std::to_string(m_group_size.x)},
                 {"##GROUPSIZE_Y##", std::to_string(m_group_size.y)},
                 {"##GROUPSIZE_Z##", std::to_string(m_group_size.z)},
             });
             Program::setup();
-            num_items.init(getGlProgram(), "num_items");
-            num_data.init(getGlProgram(), "num_data");
             checkGLError();
         }            
+        /**
+         * @brief      Setup for indices of indirection_t and buffers of
+         *             value_t, see glsl_type.
+         */
+        template<typename indirection_t, typename value_t>
+        inline void setup(glm::uvec3 group_size = glm::uvec3(1024,1,1))
+        {
+            static_assert(!glsl_type<indirection_t>::packed, "indirection type must be a glsl type");
+            setup(glsl_type<indirection_t>::name(), glsl_type<value_t>::storage_name(), group_size);
+        }
         inline void dispatch(uint32_t num_items, uint32_t num_data)
         {
             this->num_items.set(num_items);
@@ -58,6 +69,8 @@ namespace compute_programs {
         #define GROUPSIZE (GROUPSIZE_X*GROUPSIZE_Y*GROUPSIZE_Z)
         layout(local_size_x=GROUPSIZE_X, local_size_y=GROUPSIZE_Y, local_size_z=GROUPSIZE_Z) in;
 
+        ##TYPE_DECLARATIONS##
+
         layout (std430, binding = 0) buffer buf_indirection
         {
             ##INDIRECTION_TYPE## indirection[]; 
@@ -90,9 +103,49 @@ namespace compute_programs {
         )"
             );
         }            
+        /**
+         * @brief      Element-wise stage for FusedProgram gathering data[value]
+         *             from its buffer 0, dropping indices outside of the
+         *             uniform num_data.
+         */
+        static FusedProgram::Stage FusionStage(
+            const std::string& indirection_type_str,
+            const std::string& data_type_str
+        )
+        {
+            FusedProgram::Stage stage;
+            stage.name = "CopyIndirect";
+            stage.out_type = data_type_str;
+            stage.declarations = R"(
+        layout (std430, binding = ##BINDING_0##) buffer ##S##buf_data
+        {
+            ##DATA_TYPE## ##S##data[];
+        };
+        uniform uint ##S##num_data;
+            )";
+            stage.body = R"(
+            ##INDIRECTION_TYPE## ind = ##INDIRECTION_TYPE##(value);
+            bool valid = (ind >= 0) && (ind < ##S##num_data);
+            keep = keep && valid;
+            return ##S##data[valid ? ind : 0];
+            )";
+            stage.num_buffers = 1;
+            stage.replacements = {
+                {"##INDIRECTION_TYPE##", indirection_type_str},
+                {"##DATA_TYPE##", data_type_str},
+            };
+            return stage;
+        }
+
         ProgramUniform<uint32_t> num_items;
         ProgramUniform<uint32_t> num_data;
     protected:
+        void setupUniforms() override
+        {
+            num_items.init(getGlProgram(), "num_items");
+            num_data.init(getGlProgram(), "num_data");
+        }
+
         glm::uvec3 m_group_size;
     };
 
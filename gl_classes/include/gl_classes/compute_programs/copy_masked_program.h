@@ -6,11 +6,28 @@
 #include "gl_classes/program.h"
 #include "gl_classes/program_uniform.h"
 #include "gl_classes/compute_program.h"
+#include "gl_classes/device_buffer.h"
 #include "gl_classes/shader.h"
+#include "gl_classes/glsl_type.h"
+#include "gl_classes/compute_programs/fused_program.h"
 
 namespace gl_classes {
 namespace compute_programs {
 
+    /**
+     * @brief      Copies the items whose mask is not zero, appending them to
+     *             out_data at offset_out + out_count[0].
+     *
+     *      mode        | output order              | atomics on out_count
+     *      ------------|---------------------------|---------------------
+     *      Atomic      | nondeterministic          | one per item
+     *      GroupAtomic | stable within work group  | one per work group
+     *      Ordered     | stable                    | none
+     *
+     * GroupAtomic and Ordered count the kept items of each work group with
+     * a prefix sum in shared memory. Ordered additionally scans the group
+     * counts in an internal buffer bound to binding 4 by dispatch.
+     */
     class CopyMaskedProgram : public gl_classes::ComputeProgram
     {
     public:
@@ -19,35 +36,76 @@ namespace compute_programs {
         using ComputeProgram = gl_classes::ComputeProgram;
         using Shader = gl_classes::Shader;
 
-        inline CopyMaskedProgram(){}
+        enum Mode : uint32_t
+        {
+            Atomic = 0,
+            GroupAtomic = 1,
+            Ordered = 2
+        };
+
+        inline CopyMaskedProgram() : ComputeProgram("CopyMaskedProgram") {}
         inline ~CopyMaskedProgram(){}
         inline void setup(
             const std::string& data_type_str, 
-            glm::uvec3 group_size = glm::uvec3(1024,1,1)
+            glm::uvec3 group_size = glm::uvec3(1024,1,1),
+            Mode mode = Mode::GroupAtomic
         )
         {
             m_group_size = group_size;
+            m_mode = mode;
             m_shaders = {Shader(Shader::ShaderType::Compute, code())};
             m_shaders[0].setup({
                 {"##DATA_TYPE##", data_type_str},
+                {"##TYPE_DECLARATIONS##", glslDeclarations({data_type_str})},
                 {"##GROUPSIZE_X##", std::to_string(m_group_size.x)},
                 {"##GROUPSIZE_Y##", std::to_string(m_group_size.y)},
                 {"##GROUPSIZE_Z##", std::to_string(m_group_size.z)},
             });
             Program::setup();
-            num_items.init(getGlProgram(), "num_items");
-            offset_in.init(getGlProgram(), "offset_in", 0);
-            offset_mask.init(getGlProgram(), "offset_mask", 0);
-            offset_out.init(getGlProgram(), "offset_out", 0);
             checkGLError();
         }            
+        /**
+         * @brief      Setup for buffers of value_t, see glsl_type.
+         */
+        template<typename value_t>
+        inline void setup(glm::uvec3 group_size = glm::uvec3(1024,1,1), Mode mode = Mode::GroupAtomic)
+        {
+            setup(glsl_type<value_t>::storage_name(), group_size, mode);
+        }
         inline void dispatch(uint32_t num_items, uint32_t offset_in = 0, uint32_t offset_mask = 0, uint32_t offset_out = 0)
         {
             this->num_items.set(num_items);
             this->offset_in.set(offset_in);
             this->offset_mask.set(offset_mask);
             this->offset_out.set(offset_out);
-            ComputeProgram::dispatch(num_items, 1, 1, m_group_size.x, m_group_size.y, m_group_size.z);
+            if (mode.get() != Mode::Ordered)
+            {
+                pass.set(0);
+                ComputeProgram::dispatch(num_items, 1, 1, m_group_size.x, m_group_size.y, m_group_size.z);
+                return;
+            }
+            const uint64_t group_size = static_cast<uint64_t>(m_group_size.x) * m_group_size.y * m_group_size.z;
+            const uint64_t groups = num_items / group_size + ((num_items % group_size == 0) ? 0 : 1);
+            num_groups.set(static_cast<uint32_t>(groups));
+            if (m_group_counts.bufferId() == 0) m_group_counts.init();
+            if (m_group_counts.size() < groups + 1) m_group_counts.resize(groups + 1);
+            m_group_counts.bufferBase(4);
+
+            // count kept items per group
+            pass.set(0);
+            dispatchGroups(groups);
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+            // exclusive scan of group counts in a single group
+            pass.set(1);
+            ComputeProgram::dispatch(1u, 1u, 1u);
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+            // scatter
+            pass.set(2);
+            dispatchGroups(groups);
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+            // add total to out_count
+            pass.set(3);
+            ComputeProgram::dispatch(1u, 1u, 1u);
         }            
         inline std::string code() const
         {
@@ -60,6 +118,17 @@ namespace compute_programs {
         #define GROUPSIZE (GROUPSIZE_X*GROUPSIZE_Y*GROUPSIZE_Z)
         layout(local_size_x=GROUPSIZE_X, local_size_y=GROUPSIZE_Y, local_size_z=GROUPSIZE_Z) in;
 
+        ##TYPE_DECLARATIONS##
+
+        #define MODE_ATOMIC 0
+        #define MODE_GROUP_ATOMIC 1
+        #define MODE_ORDERED 2
+
+        #define PASS_COUNT 0
+        #define PASS_SCAN_GROUPS 1
+        #define PASS_SCATTER 2
+        #define PASS_TOTAL 3
+
         layout (std430, binding = 0) buffer buf_data
         {
             ##DATA_TYPE## data[]; 
@@ -76,35 +145,162 @@ namespace compute_programs {
         {
             uint out_count[]; 
         };
+        layout (std430, binding = 4) buffer buf_group_counts
+        {
+            uint group_counts[]; 
+        };
 
         uniform uint num_items;
         uniform uint offset_in;
         uniform uint offset_mask;
         uniform uint offset_out;
+        uniform uint num_groups;
+        uniform uint mode;
+        uniform uint pass;
+
+        shared uint partial[GROUPSIZE];
+        shared uint group_base;
+
+        // inclusive prefix sum of partial, must be called in uniform control flow
+        void scanPartial(uint local_idx)
+        {
+            barrier();
+            for (uint stride = 1; stride < GROUPSIZE; stride <<= 1)
+            {
+                uint left = (local_idx >= stride) ? partial[local_idx - stride] : 0;
+                barrier();
+                partial[local_idx] += left;
+                barrier();
+            }
+        }
 
         void main() {
             uint workgroup_idx = 
                 gl_WorkGroupID.z * gl_NumWorkGroups.x * gl_NumWorkGroups.y +
                 gl_WorkGroupID.y * gl_NumWorkGroups.x +
                 gl_WorkGroupID.x;
-            uint global_idx = gl_LocalInvocationIndex + workgroup_idx * GROUPSIZE;
-            if (global_idx >= num_items) return;
-            
-            if (mask[offset_mask + global_idx] != 0)
+            uint local_idx = gl_LocalInvocationIndex;
+            uint global_idx = local_idx + workgroup_idx * GROUPSIZE;
+
+            if (mode == MODE_ATOMIC)
+            {
+                if (global_idx >= num_items) return;
+                if (mask[offset_mask + global_idx] != 0)
+                {
+                    uint idx = atomicAdd(out_count[0], 1);
+                    out_data[offset_out + idx] = data[offset_in + global_idx];
+                }
+                return;
+            }
+
+            if (pass == PASS_SCAN_GROUPS)
             {
-                uint idx = atomicAdd(out_count[0], 1);
-                out_data[offset_out + idx] = data[offset_in + global_idx];
+                // each invocation scans a contiguous chunk of group counts
+                uint per_invocation = (num_groups + GROUPSIZE - 1) / GROUPSIZE;
+                uint begin = min(local_idx * per_invocation, num_groups);
+                uint end = min(begin + per_invocation, num_groups);
+                uint sum = 0;
+                for (uint i = begin; i < end; ++i) sum += group_counts[i];
+                partial[local_idx] = sum;
+                scanPartial(local_idx);
+                uint running = partial[local_idx] - sum;
+                for (uint i = begin; i < end; ++i)
+                {
+                    uint count = group_counts[i];
+                    group_counts[i] = running;
+                    running += count;
+                }
+                if (local_idx == GROUPSIZE - 1) group_counts[num_groups] = partial[local_idx];
+                return;
+            }
+            if (pass == PASS_TOTAL)
+            {
+                if (local_idx == 0) out_count[0] += group_counts[num_groups];
+                return;
+            }
+
+            // excess groups of a dispatch spread over y
+            if (workgroup_idx * GROUPSIZE >= num_items) return;
+
+            uint keep = ((global_idx < num_items) && (mask[offset_mask + global_idx] != 0)) ? 1 : 0;
+            partial[local_idx] = keep;
+            scanPartial(local_idx);
+            uint group_total = partial[GROUPSIZE - 1];
+            uint local_offset = partial[local_idx] - keep;
+
+            if (mode == MODE_ORDERED && pass == PASS_COUNT)
+            {
+                if (local_idx == 0) group_counts[workgroup_idx] = group_total;
+                return;
+            }
+
+            uint base;
+            if (mode == MODE_GROUP_ATOMIC)
+            {
+                if (local_idx == 0) group_base = (group_total > 0) ? atomicAdd(out_count[0], group_total) : 0;
+                barrier();
+                base = group_base;
+            }
+            else
+            {
+                base = out_count[0] + group_counts[workgroup_idx];
+            }
+
+            if (keep != 0)
+            {
+                out_data[offset_out + base + local_offset] = data[offset_in + global_idx];
             }
         }
         )"
             );
         }            
+        /**
+         * @brief      Element-wise stage for FusedProgram keeping the items
+         *             whose mask in its buffer 0 at offset_mask + global_idx is
+         *             not zero. The fused output is compacted.
+         */
+        static FusedProgram::Stage FusionStage()
+        {
+            FusedProgram::Stage stage;
+            stage.name = "CopyMasked";
+            stage.declarations = R"(
+        layout (std430, binding = ##BINDING_0##) buffer ##S##buf_mask
+        {
+            uint ##S##mask[];
+        };
+        uniform uint ##S##offset_mask;
+            )";
+            stage.body = R"(
+            keep = keep && (##S##mask[##S##offset_mask + global_idx] != 0);
+            return value;
+            )";
+            stage.num_buffers = 1;
+            stage.compacts = true;
+            return stage;
+        }
+
         ProgramUniform<uint32_t> num_items;
         ProgramUniform<uint32_t> offset_in;
         ProgramUniform<uint32_t> offset_mask;
         ProgramUniform<uint32_t> offset_out;
+        ProgramUniform<uint32_t> num_groups;
+        ProgramUniform<uint32_t> mode;
+        ProgramUniform<uint32_t> pass;
     protected:
+        void setupUniforms() override
+        {
+            num_items.init(getGlProgram(), "num_items");
+            offset_in.init(getGlProgram(), "offset_in", 0);
+            offset_mask.init(getGlProgram(), "offset_mask", 0);
+            offset_out.init(getGlProgram(), "offset_out", 0);
+            num_groups.init(getGlProgram(), "num_groups", 0);
+            this->mode.init(getGlProgram(), "mode", m_mode);
+            pass.init(getGlProgram(), "pass", 0);
+        }
+
         glm::uvec3 m_group_size;
+        Mode m_mode = Mode::GroupAtomic;
+        DeviceBuffer<uint32_t> m_group_counts = DeviceBuffer<uint32_t>(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_COPY);
     };
 
 } // namespace compute_programs
@@ -7,6 +7,7 @@
 #include "gl_classes/program_uniform.h"
 #include "gl_classes/compute_program.h"
 #include "gl_classes/shader.h"
+#include "gl_classes/glsl_type.h"
 
 namespace gl_classes {
 namespace compute_programs {
@@ -19,7 +20,7 @@ namespace compute_programs {
         using ComputeProgram = gl_classes::ComputeProgram;
         using Shader = gl_classes::Shader;
 
-        inline CopyProgram(){}
+        inline CopyProgram() : ComputeProgram("CopyProgram") {}
         inline ~CopyProgram(){}
         inline void setup(
             const std::string& data_type_str, 
@@ -30,16 +31,22 @@ namespace compute_programs {
             m_shaders = {Shader(Shader::ShaderType::Compute, code())};
             m_shaders[0].setup({
                 {"##DATA_TYPE##", data_type_str},
+                {"##TYPE_DECLARATIONS##", glslDeclarations({data_type_str})},
                 {"##GROUPSIZE_X##", std::to_string(m_group_size.x)},
                 {"##GROUPSIZE_Y##", std::to_string(m_group_size.y)},
                 {"##GROUPSIZE_Z##", std::to_string(m_group_size.z)},
             });
             Program::setup();
-            num_items.init(getGlProgram(), "num_items");
-            offset_in.init(getGlProgram(), "offset_in", 0);
-            offset_out.init(getGlProgram(), "offset_out", 0);
             checkGLError();
         }            
+        /**
+         * @brief      Setup for buffers of value_t, see glsl_type.
+         */
+        template<typename value_t>
+        inline void setup(glm::uvec3 group_size = glm::uvec3(1024,1,1))
+        {
+            setup(glsl_type<value_t>::storage_name(), group_size);
+        }
         void dispatch(uint32_t num_items)
         {
             this->num_items.set(num_items);
@@ -62,6 +69,8 @@ namespace compute_programs {
         #define GROUPSIZE (GROUPSIZE_X*GROUPSIZE_Y*GROUPSIZE_Z)
         layout(local_size_x=GROUPSIZE_X, local_size_y=GROUPSIZE_Y, local_size_z=GROUPSIZE_Z) in;
 
+        ##TYPE_DECLARATIONS##
+
         layout (std430, binding = 0) buffer buf_data
         {
             ##DATA_TYPE## data[]; 
@@ -92,6 +101,13 @@ namespace compute_programs {
         ProgramUniform<uint32_t> offset_in;
         ProgramUniform<uint32_t> offset_out;
     protected:
+        void setupUniforms() override
+        {
+            num_items.init(getGlProgram(), "num_items");
+            offset_in.init(getGlProgram(), "offset_in", 0);
+            offset_out.init(getGlProgram(), "offset_out", 0);
+        }
+
         //void dispatch(uint32_t x, uint32_t y, uint32_t z) override
         //{
         //    // prevent public access to CopyProgram::dispatch(uint32_t, uint32_t, uint32_t)
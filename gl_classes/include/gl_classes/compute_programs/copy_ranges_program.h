@@ -0,0 +1,239 @@
+#pragma once
+
+#include "glm/glm.hpp"
+#include <string>
+
+#include "gl_classes/program.h"
+#include "gl_classes/program_uniform.h"
+#include "gl_classes/compute_program.h"
+#include "gl_classes/device_buffer.h"
+#include "gl_classes/indirect_commands.h"
+#include "gl_classes/shader.h"
+#include "gl_classes/glsl_type.h"
+
+namespace gl_classes {
+namespace compute_programs {
+
+    /**
+     * @brief      Performs many copies of ranges, like a sequence of
+     *             CopyProgram::dispatch(count, offset_in, offset_out), with
+     *             two dispatches in total.
+     *
+     * The first dispatch runs a single work group that scans the range
+     * counts into an internal buffer of range starts and writes the
+     * indirect command for the second one. The second dispatch runs one
+     * invocation per copied item, which finds its range with a binary
+     * search over the range starts. No count is read back to the cpu.
+     *
+     *      binding | buffer
+     *      --------|----------------------------------------------
+     *      0       | input data
+     *      1       | output data
+     *      2       | CopyRange ranges, read from offset_ranges
+     *      3       | internal range starts, bound by dispatch
+     *      4       | internal DispatchIndirectCommand, bound by dispatch
+     */
+    class CopyRangesProgram : public gl_classes::ComputeProgram
+    {
+    public:
+        using Program = gl_classes::Program;
+        template<class T> using ProgramUniform = gl_classes::ProgramUniform<T>;
+        using ComputeProgram = gl_classes::ComputeProgram;
+        using Shader = gl_classes::Shader;
+
+        struct CopyRange
+        {
+            uint32_t offset_in;
+            uint32_t offset_out;
+            uint32_t count;
+        };
+
+        inline CopyRangesProgram() : ComputeProgram("CopyRangesProgram") {}
+        inline ~CopyRangesProgram(){}
+        inline void setup(
+            const std::string& data_type_str,
+            glm::uvec3 group_size = glm::uvec3(1024,1,1)
+        )
+        {
+            m_group_size = group_size;
+            m_shaders = {Shader(Shader::ShaderType::Compute, code())};
+            m_shaders[0].setup({
+                {"##DATA_TYPE##", data_type_str},
+                {"##TYPE_DECLARATIONS##", glslDeclarations({data_type_str})},
+                {"##GROUPSIZE_X##", std::to_string(m_group_size.x)},
+                {"##GROUPSIZE_Y##", std::to_string(m_group_size.y)},
+                {"##GROUPSIZE_Z##", std::to_string(m_group_size.z)},
+            });
+            m_range_starts.init();
+            m_dispatch.init();
+            m_dispatch.resize(1);
+            Program::setup();
+            checkGLError();
+        }
+        /**
+         * @brief      Setup for buffers of value_t, see glsl_type.
+         */
+        template<typename value_t>
+        inline void setup(glm::uvec3 group_size = glm::uvec3(1024,1,1))
+        {
+            setup(glsl_type<value_t>::storage_name(), group_size);
+        }
+        /**
+         * @brief      Copy the num_ranges ranges of binding 2 starting at
+         *             offset_ranges.
+         */
+        void dispatch(uint32_t num_ranges, uint32_t offset_ranges = 0)
+        {
+            this->num_ranges.set(num_ranges);
+            this->offset_ranges.set(offset_ranges);
+            if (num_ranges == 0) return;
+            // one start per range and the total
+            if (m_range_starts.size() < num_ranges + 1) m_range_starts.resize(num_ranges + 1);
+            m_range_starts.bufferBase(3);
+            m_dispatch.bufferBase(4);
+
+            pass.set(0);
+            ComputeProgram::dispatch(1u, 1u, 1u);
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+            pass.set(1);
+            dispatchIndirect(m_dispatch);
+        }
+        inline std::string code() const
+        {
+            return (
+        R"(
+        #version 440
+        #define GROUPSIZE_X ##GROUPSIZE_X##
+        #define GROUPSIZE_Y ##GROUPSIZE_Y##
+        #define GROUPSIZE_Z ##GROUPSIZE_Z##
+        #define GROUPSIZE (GROUPSIZE_X*GROUPSIZE_Y*GROUPSIZE_Z)
+        layout(local_size_x=GROUPSIZE_X, local_size_y=GROUPSIZE_Y, local_size_z=GROUPSIZE_Z) in;
+
+        ##TYPE_DECLARATIONS##
+
+        #define PASS_STARTS 0
+        #define PASS_COPY 1
+        #define MAX_GROUPS_X 65535u
+
+        struct CopyRange
+        {
+            uint offset_in;
+            uint offset_out;
+            uint count;
+        };
+
+        layout (std430, binding = 0) buffer buf_data
+        {
+            ##DATA_TYPE## data[];
+        };
+        layout (std430, binding = 1) buffer buf_out_data
+        {
+            ##DATA_TYPE## out_data[];
+        };
+        layout (std430, binding = 2) buffer buf_ranges
+        {
+            CopyRange ranges[];
+        };
+        layout (std430, binding = 3) buffer buf_range_starts
+        {
+            uint range_starts[];
+        };
+        layout (std430, binding = 4) buffer buf_dispatch
+        {
+            uint dispatch_cmd[];
+        };
+
+        uniform uint num_ranges;
+        uniform uint offset_ranges;
+        uniform uint pass;
+
+        shared uint partial[GROUPSIZE];
+
+        void main() {
+            uint workgroup_idx =
+                gl_WorkGroupID.z * gl_NumWorkGroups.x * gl_NumWorkGroups.y +
+                gl_WorkGroupID.y * gl_NumWorkGroups.x +
+                gl_WorkGroupID.x;
+            uint local_idx = gl_LocalInvocationIndex;
+            uint global_idx = local_idx + workgroup_idx * GROUPSIZE;
+
+            if (pass == PASS_STARTS)
+            {
+                // each invocation scans a contiguous chunk of ranges
+                uint chunk = (num_ranges + GROUPSIZE - 1) / GROUPSIZE;
+                uint begin = min(local_idx * chunk, num_ranges);
+                uint end = min(begin + chunk, num_ranges);
+                uint sum = 0;
+                for (uint i = begin; i < end; ++i) sum += ranges[offset_ranges + i].count;
+                partial[local_idx] = sum;
+                barrier();
+                for (uint stride = 1; stride < GROUPSIZE; stride <<= 1)
+                {
+                    uint left = (local_idx >= stride) ? partial[local_idx - stride] : 0;
+                    barrier();
+                    partial[local_idx] += left;
+                    barrier();
+                }
+                uint running = partial[local_idx] - sum;
+                for (uint i = begin; i < end; ++i)
+                {
+                    range_starts[i] = running;
+                    running += ranges[offset_ranges + i].count;
+                }
+                if (local_idx == GROUPSIZE - 1)
+                {
+                    uint total = partial[local_idx];
+                    range_starts[num_ranges] = total;
+                    uint num_groups = (total + GROUPSIZE - 1) / GROUPSIZE;
+                    uint gx = min(num_groups, MAX_GROUPS_X);
+                    dispatch_cmd[0] = gx;
+                    dispatch_cmd[1] = (gx == 0) ? 0 : ((num_groups + gx - 1) / gx);
+                    dispatch_cmd[2] = (gx == 0) ? 0 : 1;
+                }
+                return;
+            }
+
+            if (global_idx >= range_starts[num_ranges]) return;
+            // last range starting at or before global_idx, skips empty ranges
+            uint lo = 0;
+            uint hi = num_ranges;
+            while (hi - lo > 1)
+            {
+                uint mid = (lo + hi) / 2;
+                if (range_starts[mid] <= global_idx) lo = mid;
+                else hi = mid;
+            }
+            CopyRange range = ranges[offset_ranges + lo];
+            uint local = global_idx - range_starts[lo];
+            out_data[range.offset_out + local] = data[range.offset_in + local];
+        }
+        )"
+            );
+        }
+        ProgramUniform<uint32_t> num_ranges;
+        ProgramUniform<uint32_t> offset_ranges;
+        ProgramUniform<uint32_t> pass;
+
+        glm::uvec3 group_size() const { return m_group_size; }
+        /**
+         * @brief      Exclusive prefix sum of the range counts of the last
+         *             dispatch, followed by the total number of items.
+         */
+        const DeviceBuffer<uint32_t>& range_starts() const { return m_range_starts; }
+
+    protected:
+        void setupUniforms() override
+        {
+            num_ranges.init(getGlProgram(), "num_ranges", 0);
+            offset_ranges.init(getGlProgram(), "offset_ranges", 0);
+            pass.init(getGlProgram(), "pass", 0);
+        }
+
+        glm::uvec3 m_group_size;
+        DeviceBuffer<uint32_t> m_range_starts = DeviceBuffer<uint32_t>(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_COPY);
+        DeviceBuffer<DispatchIndirectCommand> m_dispatch = DeviceBuffer<DispatchIndirectCommand>(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_COPY);
+    };
+
+} // namespace compute_programs
+} // namespace gl_classes
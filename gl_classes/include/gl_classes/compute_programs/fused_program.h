@@ -0,0 +1,252 @@
+#pragma once
+
+#include "glm/glm.hpp"
+#include <string>
+#include <vector>
+#include <utility>
+#include <stdexcept>
+
+#include "gl_classes/program.h"
+#include "gl_classes/program_uniform.h"
+#include "gl_classes/compute_program.h"
+#include "gl_classes/shader.h"
+#include "gl_classes/shader_template.h"
+
+namespace gl_classes {
+namespace compute_programs {
+
+    /**
+     * @brief      One compute shader running a chain of element-wise stages,
+     *             keeping the intermediate values in registers instead of
+     *             writing and reading them back from global memory.
+     *
+     * Each stage is a glsl function body. It gets the value of the previous
+     * stage as `value`, the item index as `global_idx` and can drop the item
+     * by setting `keep = false`. It returns the value for the next stage.
+     * Element-wise programs provide their stage with a static FusionStage(),
+     * for example SetSequenceProgram, CopyIndirectProgram and
+     * CopyMaskedProgram.
+     *
+     *      binding | buffer
+     *      --------|----------------------------------------------
+     *      0       | input data, unless input_type_str is empty
+     *      1       | output data
+     *      2       | uint out_count, only if a stage compacts
+     *      3...    | buffers of the stages, see binding()
+     *
+     * Without input the first stage gets `uint value = global_idx`. Kept
+     * items are written to out_data[offset_out + global_idx], or appended
+     * at offset_out + atomicAdd(out_count[0], 1) if any stage compacts, with
+     * nondeterministic order like CopyMaskedProgram::Atomic.
+     *
+     * Uniforms of a stage are prefixed to keep them apart, use uniformName()
+     * to initialize ProgramUniforms for them after setup.
+     */
+    class FusedProgram : public gl_classes::ComputeProgram
+    {
+    public:
+        using Program = gl_classes::Program;
+        template<class T> using ProgramUniform = gl_classes::ProgramUniform<T>;
+        using ComputeProgram = gl_classes::ComputeProgram;
+        using Shader = gl_classes::Shader;
+
+        struct Stage
+        {
+            std::string name;
+            // glsl type returned by the body, empty for the type of value
+            std::string out_type;
+            // glsl at global scope: ##S## is replaced by the stage prefix,
+            // ##BINDING_0##, ##BINDING_1##, ... by the bindings of its buffers
+            std::string declarations;
+            // glsl function body, ##S## as in declarations
+            std::string body;
+            uint32_t num_buffers = 0;
+            bool compacts = false;
+            std::vector<std::pair<std::string, std::string>> replacements;
+        };
+
+        inline FusedProgram() : ComputeProgram("FusedProgram") {}
+        inline ~FusedProgram(){}
+
+        /**
+         * @param[in]  stages          The stages in order of execution
+         * @param[in]  input_type_str  The glsl type of the input data or
+         *                             empty to run on the item indices
+         * @param[in]  group_size      The group size
+         */
+        inline void setup(
+            const std::vector<Stage>& stages,
+            const std::string& input_type_str = "",
+            glm::uvec3 group_size = glm::uvec3(1024,1,1)
+        )
+        {
+            if (stages.empty())
+            {
+                throw std::runtime_error("FusedProgram needs at least one stage");
+            }
+            m_group_size = group_size;
+            m_stages = stages;
+            m_input_type = input_type_str;
+            std::string name;
+            for (const auto& stage : m_stages)
+            {
+                name += (name.empty() ? "" : "+") + stage.name;
+            }
+            setName("FusedProgram(" + name + ")");
+            m_shaders = {Shader(Shader::ShaderType::Compute, code())};
+            m_shaders[0].setup({
+                {"##GROUPSIZE_X##", std::to_string(m_group_size.x)},
+                {"##GROUPSIZE_Y##", std::to_string(m_group_size.y)},
+                {"##GROUPSIZE_Z##", std::to_string(m_group_size.z)},
+            });
+            Program::setup();
+            checkGLError();
+        }
+        void dispatch(uint32_t num_items)
+        {
+            this->num_items.set(num_items);
+            ComputeProgram::dispatch(num_items, 1, 1, m_group_size.x, m_group_size.y, m_group_size.z);
+        }
+        void dispatch(uint32_t num_items, uint32_t offset_in, uint32_t offset_out)
+        {
+            this->offset_in.set(offset_in);
+            this->offset_out.set(offset_out);
+            dispatch(num_items);
+        }
+
+        /**
+         * @brief      Binding of buffer k of the stage.
+         */
+        GLuint binding(size_t stage, uint32_t k) const
+        {
+            GLuint result = 3;
+            for (size_t i = 0; i < stage; ++i) result += m_stages[i].num_buffers;
+            return result + k;
+        }
+
+        /**
+         * @brief      Name of uniform `##S##name` of the stage in the fused
+         *             shader.
+         */
+        static std::string uniformName(size_t stage, const std::string& name)
+        {
+            return prefix(stage) + name;
+        }
+
+        /**
+         * @brief      The code assembled from the stages, with the group size
+         *             still to be substituted.
+         */
+        inline std::string code() const
+        {
+            bool compacts = false;
+            for (const auto& stage : m_stages) compacts = compacts || stage.compacts;
+
+            std::string stage_code;
+            std::string chain;
+            std::string value_type = m_input_type.empty() ? "uint" : m_input_type;
+            std::string value_var = "v0";
+            for (size_t i = 0; i < m_stages.size(); ++i)
+            {
+                const Stage& stage = m_stages[i];
+                std::string out_type = stage.out_type.empty() ? value_type : stage.out_type;
+                ShaderTemplate::Replacements replacements = stage.replacements;
+                replacements.push_back({"##S##", prefix(i)});
+                for (uint32_t k = 0; k < stage.num_buffers; ++k)
+                {
+                    replacements.push_back({"##BINDING_" + std::to_string(k) + "##", std::to_string(binding(i, k))});
+                }
+                std::string apply = prefix(i) + "apply";
+                stage_code += "        // " + stage.name + "\n";
+                stage_code += ShaderTemplate(stage.declarations).render(replacements) + "\n";
+                stage_code += "        " + out_type + " " + apply + "(" + value_type + " value, uint global_idx, inout bool keep)\n        {\n";
+                stage_code += ShaderTemplate(stage.body).render(replacements) + "\n        }\n";
+
+                std::string next_var = "v" + std::to_string(i + 1);
+                chain += "            " + out_type + " " + next_var + " = " + apply + "(" + value_var + ", global_idx, keep);\n";
+                chain += "            if (!keep) return;\n";
+                value_type = out_type;
+                value_var = next_var;
+            }
+
+            std::string input_decl;
+            std::string input_read = "uint v0 = global_idx;";
+            if (!m_input_type.empty())
+            {
+                input_decl =
+                    "        layout (std430, binding = 0) buffer buf_data\n"
+                    "        {\n"
+                    "            " + m_input_type + " data[];\n"
+                    "        };\n";
+                input_read = m_input_type + " v0 = data[offset_in + global_idx];";
+            }
+            std::string output_write = compacts
+                ? "out_data[offset_out + atomicAdd(out_count[0], 1)] = " + value_var + ";"
+                : "out_data[offset_out + global_idx] = " + value_var + ";";
+
+            return (
+        R"(
+        #version 440
+        #define GROUPSIZE_X ##GROUPSIZE_X##
+        #define GROUPSIZE_Y ##GROUPSIZE_Y##
+        #define GROUPSIZE_Z ##GROUPSIZE_Z##
+        #define GROUPSIZE (GROUPSIZE_X*GROUPSIZE_Y*GROUPSIZE_Z)
+        layout(local_size_x=GROUPSIZE_X, local_size_y=GROUPSIZE_Y, local_size_z=GROUPSIZE_Z) in;
+
+)" + input_decl + R"(
+        layout (std430, binding = 1) buffer buf_out_data
+        {
+            )" + value_type + R"( out_data[];
+        };
+        layout (std430, binding = 2) buffer buf_out_count
+        {
+            uint out_count[];
+        };
+
+        uniform uint num_items;
+        uniform uint offset_in;
+        uniform uint offset_out;
+
+)" + stage_code + R"(
+        void main() {
+            uint workgroup_idx =
+                gl_WorkGroupID.z * gl_NumWorkGroups.x * gl_NumWorkGroups.y +
+                gl_WorkGroupID.y * gl_NumWorkGroups.x +
+                gl_WorkGroupID.x;
+            uint global_idx = gl_LocalInvocationIndex + workgroup_idx * GROUPSIZE;
+            if (global_idx >= num_items) return;
+            bool keep = true;
+            )" + input_read + R"(
+)" + chain + R"(
+            )" + output_write + R"(
+        }
+        )"
+            );
+        }
+        ProgramUniform<uint32_t> num_items;
+        ProgramUniform<uint32_t> offset_in;
+        ProgramUniform<uint32_t> offset_out;
+
+        const std::vector<Stage>& stages() const { return m_stages; }
+        glm::uvec3 group_size() const { return m_group_size; }
+
+    protected:
+        void setupUniforms() override
+        {
+            num_items.init(getGlProgram(), "num_items");
+            offset_in.init(getGlProgram(), "offset_in", 0);
+            offset_out.init(getGlProgram(), "offset_out", 0);
+        }
+
+        static std::string prefix(size_t stage)
+        {
+            return "s" + std::to_string(stage) + "_";
+        }
+
+        glm::uvec3 m_group_size;
+        std::vector<Stage> m_stages;
+        std::string m_input_type;
+    };
+
+} // namespace compute_programs
+} // namespace gl_classes
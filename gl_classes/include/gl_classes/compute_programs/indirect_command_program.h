@@ -0,0 +1,153 @@
+#pragma once
+
+#include "glm/glm.hpp"
+#include <string>
+
+#include "gl_classes/program.h"
+#include "gl_classes/program_uniform.h"
+#include "gl_classes/compute_program.h"
+#include "gl_classes/indirect_commands.h"
+#include "gl_classes/shader.h"
+
+namespace gl_classes {
+namespace compute_programs {
+
+    /**
+     * @brief      Turns an item count written on the gpu, for example
+     *             out_count of CopyMaskedProgram, into indirect commands, so
+     *             the following stages need no readback of the count.
+     *
+     *      binding | buffer
+     *      --------|----------------------------------------------
+     *      0       | uint item counts, read at offset_count
+     *      1       | DispatchIndirectCommand, written at offset_dispatch
+     *      2       | DrawArraysIndirectCommand, written at offset_draw
+     *
+     * The dispatch command covers the counted items with groups of
+     * items_per_group, spread over y like ComputeProgram::dispatchGroups.
+     * Programs dispatched with it do not know the count; set their
+     * num_items to the buffer capacity and ignore results past the count.
+     *
+     * dispatch() issues the memory barriers needed before the commands are
+     * used by ComputeProgram::dispatchIndirect or glDrawArraysIndirect.
+     */
+    class IndirectCommandProgram : public gl_classes::ComputeProgram
+    {
+    public:
+        using Program = gl_classes::Program;
+        template<class T> using ProgramUniform = gl_classes::ProgramUniform<T>;
+        using ComputeProgram = gl_classes::ComputeProgram;
+        using Shader = gl_classes::Shader;
+
+        inline IndirectCommandProgram() : ComputeProgram("IndirectCommandProgram") {}
+        inline ~IndirectCommandProgram(){}
+        inline void setup()
+        {
+            m_shaders = {Shader(Shader::ShaderType::Compute, code())};
+            m_shaders[0].setup({});
+            Program::setup();
+            checkGLError();
+        }
+        /**
+         * @brief      Write the dispatch command for groups of group_size.
+         */
+        inline void dispatch(glm::uvec3 group_size)
+        {
+            dispatch(group_size.x * group_size.y * group_size.z, true, false);
+        }
+        /**
+         * @param[in]  items_per_group  Number of items covered by each group
+         * @param[in]  write_dispatch   Whether to write to binding 1
+         * @param[in]  write_draw       Whether to write to binding 2
+         */
+        inline void dispatch(uint32_t items_per_group, bool write_dispatch, bool write_draw)
+        {
+            this->items_per_group.set(items_per_group);
+            this->write_dispatch.set(write_dispatch);
+            this->write_draw.set(write_draw);
+            ComputeProgram::dispatch(1u, 1u, 1u);
+            glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+        }
+        inline std::string code() const
+        {
+            return (
+        R"(
+        #version 440
+        layout(local_size_x=1, local_size_y=1, local_size_z=1) in;
+
+        layout (std430, binding = 0) buffer buf_count
+        {
+            uint count[];
+        };
+        layout (std430, binding = 1) buffer buf_dispatch
+        {
+            uint dispatch_cmd[];
+        };
+        layout (std430, binding = 2) buffer buf_draw
+        {
+            uint draw_cmd[];
+        };
+
+        uniform uint offset_count;
+        uniform uint offset_dispatch;
+        uniform uint offset_draw;
+        uniform uint items_per_group;
+        uniform uint max_groups_x;
+        uniform uint first;
+        uniform uint instance_count;
+        uniform uint base_instance;
+        uniform bool write_dispatch;
+        uniform bool write_draw;
+
+        void main() {
+            uint num_items = count[offset_count];
+            if (write_dispatch)
+            {
+                uint num_groups = (num_items + items_per_group - 1) / items_per_group;
+                uint gx = min(num_groups, max_groups_x);
+                uint gy = (gx == 0) ? 0 : ((num_groups + gx - 1) / gx);
+                uint idx = offset_dispatch * 3;
+                dispatch_cmd[idx + 0] = gx;
+                dispatch_cmd[idx + 1] = gy;
+                dispatch_cmd[idx + 2] = (gx == 0) ? 0 : 1;
+            }
+            if (write_draw)
+            {
+                uint idx = offset_draw * 4;
+                draw_cmd[idx + 0] = num_items;
+                draw_cmd[idx + 1] = instance_count;
+                draw_cmd[idx + 2] = first;
+                draw_cmd[idx + 3] = base_instance;
+            }
+        }
+        )"
+            );
+        }
+        ProgramUniform<uint32_t> offset_count;
+        ProgramUniform<uint32_t> offset_dispatch; // in commands
+        ProgramUniform<uint32_t> offset_draw;     // in commands
+        ProgramUniform<uint32_t> items_per_group;
+        ProgramUniform<uint32_t> max_groups_x;
+        ProgramUniform<uint32_t> first;
+        ProgramUniform<uint32_t> instance_count;
+        ProgramUniform<uint32_t> base_instance;
+        ProgramUniform<bool> write_dispatch;
+        ProgramUniform<bool> write_draw;
+    protected:
+        void setupUniforms() override
+        {
+            offset_count.init(getGlProgram(), "offset_count", 0);
+            offset_dispatch.init(getGlProgram(), "offset_dispatch", 0);
+            offset_draw.init(getGlProgram(), "offset_draw", 0);
+            items_per_group.init(getGlProgram(), "items_per_group", 1);
+            max_groups_x.init(getGlProgram(), "max_groups_x", 65535);
+            first.init(getGlProgram(), "first", 0);
+            instance_count.init(getGlProgram(), "instance_count", 1);
+            base_instance.init(getGlProgram(), "base_instance", 0);
+            write_dispatch.init(getGlProgram(), "write_dispatch", true);
+            write_draw.init(getGlProgram(), "write_draw", false);
+        }
+    };
+
+} // namespace compute_programs
+} // namespace gl_classes
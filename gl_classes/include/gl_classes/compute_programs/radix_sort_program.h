@@ -0,0 +1,396 @@
+#pragma once
+
+#include "glm/glm.hpp"
+#include <string>
+#include <type_traits>
+#include <stdexcept>
+
+#include "gl_classes/program.h"
+#include "gl_classes/program_uniform.h"
+#include "gl_classes/compute_program.h"
+#include "gl_classes/device_buffer.h"
+#include "gl_classes/shader.h"
+#include "gl_classes/glsl_type.h"
+#include "gl_classes/compute_programs/scan_program.h"
+
+namespace gl_classes {
+namespace compute_programs {
+
+    /**
+     * @brief      Stable least significant digit radix sort of uint, int or
+     *             float keys, with an optional payload sorted along.
+     *
+     * Each pass sorts 4 bits: every work group builds a histogram of its
+     * block, the histograms are scanned with ScanProgram and every work
+     * group sorts its block locally in shared memory and scatters it to the
+     * scanned offsets.
+     *
+     * A payload of "uint" indices initialized with SetSequenceProgram gives
+     * the sorting permutation, which can be used as indirection in
+     * CopyIndirectProgram.
+     *
+     * dispatch binds all buffers itself, using bindings 0 to 4.
+     */
+    class RadixSortProgram : public gl_classes::ComputeProgram
+    {
+    public:
+        using Program = gl_classes::Program;
+        template<class T> using ProgramUniform = gl_classes::ProgramUniform<T>;
+        using ComputeProgram = gl_classes::ComputeProgram;
+        using Shader = gl_classes::Shader;
+
+        static constexpr uint32_t radix_bits = 4;
+
+        inline RadixSortProgram() : ComputeProgram("RadixSortProgram") {}
+        inline ~RadixSortProgram(){}
+
+        /**
+         * @param[in]  key_type_str      The key type, one of "uint", "int"
+         *                               or "float"
+         * @param[in]  payload_type_str  The glsl type of the payload, empty
+         *                               to sort keys only
+         * @param[in]  group_size        The group size
+         */
+        inline void setup(
+            const std::string& key_type_str,
+            const std::string& payload_type_str = "",
+            glm::uvec3 group_size = glm::uvec3(1024,1,1)
+        )
+        {
+            if ((key_type_str != "uint") && (key_type_str != "int") && (key_type_str != "float"))
+            {
+                throw std::runtime_error("RadixSortProgram: unsupported key type " + key_type_str);
+            }
+            m_group_size = group_size;
+            m_has_payload = !payload_type_str.empty();
+            m_shaders = {Shader(Shader::ShaderType::Compute, code())};
+            m_shaders[0].setup({
+                {"##KEY_TYPE##", key_type_str},
+                {"##HAS_PAYLOAD##", m_has_payload ? "1" : "0"},
+                {"##PAYLOAD_TYPE##", m_has_payload ? payload_type_str : "uint"},
+                {"##TYPE_DECLARATIONS##", glslDeclarations({payload_type_str})},
+                {"##GROUPSIZE_X##", std::to_string(m_group_size.x)},
+                {"##GROUPSIZE_Y##", std::to_string(m_group_size.y)},
+                {"##GROUPSIZE_Z##", std::to_string(m_group_size.z)},
+            });
+            m_scan.inclusive(false);
+            m_scan.async(async());
+            m_scan.setup("uint");
+            m_keys_tmp.init();
+            m_payload_tmp.init();
+            m_histogram.init();
+            Program::setup();
+            checkGLError();
+        }
+
+        /**
+         * @brief      Setup for keys of key_t, one of uint32_t, int32_t or
+         *             float, without payload.
+         */
+        template<typename key_t>
+        inline void setup(glm::uvec3 group_size = glm::uvec3(1024,1,1))
+        {
+            static_assert(
+                std::is_same<key_t, uint32_t>::value || std::is_same<key_t, int32_t>::value || std::is_same<key_t, float>::value,
+                "RadixSortProgram: unsupported key type");
+            setup(glsl_type<key_t>::name(), "", group_size);
+        }
+
+        /**
+         * @brief      Setup for keys of key_t with payload of payload_t, see
+         *             glsl_type.
+         */
+        template<typename key_t, typename payload_t>
+        inline void setup(glm::uvec3 group_size = glm::uvec3(1024,1,1))
+        {
+            static_assert(
+                std::is_same<key_t, uint32_t>::value || std::is_same<key_t, int32_t>::value || std::is_same<key_t, float>::value,
+                "RadixSortProgram: unsupported key type");
+            setup(glsl_type<key_t>::name(), glsl_type<payload_t>::storage_name(), group_size);
+        }
+
+        /**
+         * @brief      Sort the first num_items keys.
+         *
+         * @param      keys      The keys, a DeviceBuffer of 4 byte values
+         * @param[in]  num_items  The number of items
+         * @param[in]  num_bits   Only sort by the lowest num_bits bits, for
+         *                        example 16 if all keys are below 65536.
+         *                        For int and float keys use 32.
+         */
+        template<class keys_buffer_t>
+        void dispatch(keys_buffer_t& keys, uint32_t num_items, uint32_t num_bits = 32)
+        {
+            static_assert(keys_buffer_t::element_size == 4, "keys must be 4 byte values");
+            if (bufferOffsetBytes(keys) != 0)
+            {
+                throw std::runtime_error("RadixSortProgram needs whole buffer objects");
+            }
+            sort(keys.bufferId(), 0, 0, num_items, num_bits);
+        }
+
+        /**
+         * @brief      Sort the first num_items keys and reorder payload
+         *             accordingly.
+         */
+        template<class keys_buffer_t, class payload_buffer_t>
+        void dispatch(keys_buffer_t& keys, payload_buffer_t& payload, uint32_t num_items, uint32_t num_bits = 32)
+        {
+            static_assert(keys_buffer_t::element_size == 4, "keys must be 4 byte values");
+            if (!m_has_payload)
+            {
+                throw std::runtime_error("RadixSortProgram was setup without payload type");
+            }
+            if ((bufferOffsetBytes(keys) != 0) || (bufferOffsetBytes(payload) != 0))
+            {
+                throw std::runtime_error("RadixSortProgram needs whole buffer objects");
+            }
+            sort(keys.bufferId(), payload.bufferId(), payload_buffer_t::element_size, num_items, num_bits);
+        }
+
+        inline std::string code() const
+        {
+            return (
+        R"(
+        #version 440
+        #define GROUPSIZE_X ##GROUPSIZE_X##
+        #define GROUPSIZE_Y ##GROUPSIZE_Y##
+        #define GROUPSIZE_Z ##GROUPSIZE_Z##
+        #define GROUPSIZE (GROUPSIZE_X*GROUPSIZE_Y*GROUPSIZE_Z)
+        layout(local_size_x=GROUPSIZE_X, local_size_y=GROUPSIZE_Y, local_size_z=GROUPSIZE_Z) in;
+
+        ##TYPE_DECLARATIONS##
+
+        #define KEY_TYPE_##KEY_TYPE##
+        #define HAS_PAYLOAD ##HAS_PAYLOAD##
+        #define RADIX_BITS 4
+        #define RADIX 16
+
+        #define PASS_HISTOGRAM 0
+        #define PASS_SCATTER 1
+
+        layout (std430, binding = 0) buffer buf_keys_in
+        {
+            uint keys_in[];
+        };
+        layout (std430, binding = 1) buffer buf_keys_out
+        {
+            uint keys_out[];
+        };
+        #if HAS_PAYLOAD
+        layout (std430, binding = 2) buffer buf_payload_in
+        {
+            ##PAYLOAD_TYPE## payload_in[];
+        };
+        layout (std430, binding = 3) buffer buf_payload_out
+        {
+            ##PAYLOAD_TYPE## payload_out[];
+        };
+        #endif
+        layout (std430, binding = 4) buffer buf_histogram
+        {
+            uint histogram[];
+        };
+
+        uniform uint num_items;
+        uniform uint num_groups;
+        uniform uint shift;
+        uniform uint pass;
+
+        shared uint s_scan[GROUPSIZE];
+        shared uint s_keys[GROUPSIZE];
+        shared uint s_digits[GROUPSIZE];
+        shared uint s_src[GROUPSIZE];
+        shared uint s_counts[RADIX];
+        shared uint s_starts[RADIX];
+
+        // map key bits to uint with the same order
+        uint sortable(uint bits)
+        {
+        #if defined(KEY_TYPE_float)
+            return ((bits & 0x80000000u) != 0u) ? ~bits : (bits | 0x80000000u);
+        #elif defined(KEY_TYPE_int)
+            return bits ^ 0x80000000u;
+        #else
+            return bits;
+        #endif
+        }
+
+        // inclusive prefix sum of s_scan, must be called in uniform control flow
+        void scanLocal(uint local_idx)
+        {
+            barrier();
+            for (uint stride = 1; stride < GROUPSIZE; stride <<= 1)
+            {
+                uint left = (local_idx >= stride) ? s_scan[local_idx - stride] : 0;
+                barrier();
+                s_scan[local_idx] += left;
+                barrier();
+            }
+        }
+
+        void main() {
+            uint workgroup_idx =
+                gl_WorkGroupID.z * gl_NumWorkGroups.x * gl_NumWorkGroups.y +
+                gl_WorkGroupID.y * gl_NumWorkGroups.x +
+                gl_WorkGroupID.x;
+            uint local_idx = gl_LocalInvocationIndex;
+            uint global_idx = local_idx + workgroup_idx * GROUPSIZE;
+            // excess groups of a dispatch spread over y
+            if (workgroup_idx >= num_groups) return;
+
+            bool valid = global_idx < num_items;
+            uint key = valid ? keys_in[global_idx] : 0u;
+            // invalid items get the highest digit, so they stay behind all valid items
+            uint digit = valid ? ((sortable(key) >> shift) & (RADIX - 1u)) : (RADIX - 1u);
+
+            if (local_idx < RADIX) s_counts[local_idx] = 0;
+            barrier();
+            if (valid) atomicAdd(s_counts[digit], 1u);
+            barrier();
+
+            if (pass == PASS_HISTOGRAM)
+            {
+                if (local_idx < RADIX) histogram[local_idx * num_groups + workgroup_idx] = s_counts[local_idx];
+                return;
+            }
+
+            if (local_idx == 0)
+            {
+                uint sum = 0;
+                for (uint d = 0; d < RADIX; ++d)
+                {
+                    s_starts[d] = sum;
+                    sum += s_counts[d];
+                }
+            }
+
+            // stable local sort by digit with one split per bit
+            uint src = local_idx;
+            for (uint bit = 0; bit < RADIX_BITS; ++bit)
+            {
+                uint is_zero = (((digit >> bit) & 1u) == 0u) ? 1u : 0u;
+                s_scan[local_idx] = is_zero;
+                scanLocal(local_idx);
+                uint zeros_before = s_scan[local_idx] - is_zero;
+                uint num_zeros = s_scan[GROUPSIZE - 1];
+                uint pos = (is_zero != 0u) ? zeros_before : (num_zeros + local_idx - zeros_before);
+                s_keys[pos] = key;
+                s_digits[pos] = digit;
+                s_src[pos] = src;
+                barrier();
+                key = s_keys[local_idx];
+                digit = s_digits[local_idx];
+                src = s_src[local_idx];
+                barrier();
+            }
+
+            uint num_valid = s_starts[RADIX - 1u] + s_counts[RADIX - 1u];
+            if (local_idx >= num_valid) return;
+
+            uint dst = histogram[digit * num_groups + workgroup_idx] + (local_idx - s_starts[digit]);
+            keys_out[dst] = key;
+        #if HAS_PAYLOAD
+            payload_out[dst] = payload_in[workgroup_idx * GROUPSIZE + src];
+        #endif
+        }
+        )"
+            );
+        }
+        ProgramUniform<uint32_t> num_items;
+        ProgramUniform<uint32_t> num_groups;
+        ProgramUniform<uint32_t> shift;
+        ProgramUniform<uint32_t> pass;
+
+        glm::uvec3 group_size() const { return m_group_size; }
+
+    protected:
+        void setupUniforms() override
+        {
+            num_items.init(getGlProgram(), "num_items");
+            num_groups.init(getGlProgram(), "num_groups");
+            shift.init(getGlProgram(), "shift", 0);
+            pass.init(getGlProgram(), "pass", 0);
+        }
+
+        void sort(GLuint keys, GLuint payload, size_t payload_element_size, uint32_t num_items, uint32_t num_bits)
+        {
+            if (num_items <= 1) return;
+            const uint64_t group_size = static_cast<uint64_t>(m_group_size.x) * m_group_size.y * m_group_size.z;
+            const uint64_t groups = num_items / group_size + ((num_items % group_size == 0) ? 0 : 1);
+            const uint64_t radix = uint64_t(1) << radix_bits;
+            const uint32_t num_passes = (num_bits + radix_bits - 1) / radix_bits;
+
+            if (m_keys_tmp.size() < num_items) m_keys_tmp.resize(num_items);
+            if (m_histogram.size() < radix * groups) m_histogram.resize(radix * groups);
+            if (payload != 0)
+            {
+                size_t payload_bytes = payload_element_size * num_items;
+                if (m_payload_tmp.size() < payload_bytes) m_payload_tmp.resize(payload_bytes);
+            }
+            this->num_items.set(num_items);
+            this->num_groups.set(static_cast<uint32_t>(groups));
+
+            GLuint keys_buffers[2] = { keys, m_keys_tmp.bufferId() };
+            GLuint payload_buffers[2] = { payload, m_payload_tmp.bufferId() };
+            for (uint32_t i = 0; i < num_passes; ++i)
+            {
+                int in = i % 2;
+                int out = 1 - in;
+                shift.set(i * radix_bits);
+
+                glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, keys_buffers[in]);
+                glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, m_histogram.bufferId());
+                use();
+                pass.set(0);
+                dispatchGroups(groups);
+                glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+                // exclusive scan of the digit major histogram gives the output offset
+                // of each (digit, group) pair
+                glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_histogram.bufferId());
+                glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_histogram.bufferId());
+                m_scan.use();
+                m_scan.dispatch(static_cast<uint32_t>(radix * groups), 0, 0);
+
+                glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, keys_buffers[in]);
+                glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, keys_buffers[out]);
+                if (payload != 0)
+                {
+                    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, payload_buffers[in]);
+                    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, payload_buffers[out]);
+                }
+                glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, m_histogram.bufferId());
+                use();
+                pass.set(1);
+                dispatchGroups(groups);
+                glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+            }
+            if (num_passes % 2 == 1)
+            {
+                // result is in the temporary buffers
+                glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+                copyBuffer(m_keys_tmp.bufferId(), keys, 4 * num_items);
+                if (payload != 0)
+                {
+                    copyBuffer(m_payload_tmp.bufferId(), payload, payload_element_size * num_items);
+                }
+            }
+        }
+        static void copyBuffer(GLuint src, GLuint dst, size_t num_bytes)
+        {
+            glBindBuffer(GL_COPY_READ_BUFFER, src);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, dst);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, num_bytes);
+        }
+
+        glm::uvec3 m_group_size;
+        bool m_has_payload = false;
+        ScanProgram<uint32_t> m_scan;
+        DeviceBuffer<uint32_t> m_keys_tmp = DeviceBuffer<uint32_t>(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_COPY);
+        DeviceBuffer<uint8_t> m_payload_tmp = DeviceBuffer<uint8_t>(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_COPY);
+        DeviceBuffer<uint32_t> m_histogram = DeviceBuffer<uint32_t>(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_COPY);
+    };
+
+} // namespace compute_programs
+} // namespace gl_classes
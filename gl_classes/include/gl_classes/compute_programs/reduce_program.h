@@ -0,0 +1,423 @@
+#pragma once
+
+#include "glm/glm.hpp"
+#include <string>
+#include <stdexcept>
+
+#include "gl_classes/program.h"
+#include "gl_classes/program_uniform.h"
+#include "gl_classes/compute_program.h"
+#include "gl_classes/device_buffer.h"
+#include "gl_classes/has_extension.h"
+#include "gl_classes/shader.h"
+#include "gl_classes/glsl_type.h"
+
+namespace gl_classes {
+namespace compute_programs {
+
+    /**
+     * @brief      Parallel reduction of a buffer into a single value, which
+     *             stays on the device.
+     *
+     * The first pass reduces the items with a grid stride loop into one
+     * partial result per work group, the second pass reduces the partial
+     * results in a single work group. Within a work group subgroup shuffles
+     * are used if GL_KHR_shader_subgroup is available and the group size is
+     * a multiple of the subgroup size, shared memory otherwise.
+     *
+     * Min and Max work component wise on vector types, for example to
+     * compute the bounding box of points. Tightly packed 3 component input,
+     * like a buffer of glm::vec3, is read through its storage type, for
+     * example "packed_vec3", and reduced as vec3. ArgMin and ArgMax
+     * only work on scalar types and write the index of the first minimal or
+     * maximal item as uint.
+     *
+     *      binding | buffer
+     *      --------|----------------------------------------------
+     *      0       | input data
+     *      1       | output, data type or uint for ArgMin, ArgMax
+     *      3, 4    | internal partial results, bound by dispatch
+     *
+     * @tparam     value_t  Value type, must match data_type_str
+     */
+    template<typename value_t>
+    class ReduceProgram : public gl_classes::ComputeProgram
+    {
+    public:
+        using Program = gl_classes::Program;
+        template<class T> using ProgramUniform = gl_classes::ProgramUniform<T>;
+        using ComputeProgram = gl_classes::ComputeProgram;
+        using Shader = gl_classes::Shader;
+
+        enum Operation
+        {
+            Sum,
+            Min,
+            Max,
+            ArgMin,
+            ArgMax
+        };
+
+        using value_type = value_t;
+        inline ReduceProgram() : ComputeProgram("ReduceProgram") {}
+        inline ~ReduceProgram(){}
+
+        /**
+         * @param[in]  data_type_str  The glsl data type or its storage type,
+         *                            for example "float" or "packed_vec3"
+         */
+        inline void setup(
+            const std::string& data_type_str,
+            Operation operation = Operation::Sum,
+            glm::uvec3 group_size = glm::uvec3(1024,1,1)
+        )
+        {
+            const std::string type_str = ValueTypeString(data_type_str);
+            switch (operation)
+            {
+            case Sum:    setup(data_type_str, "a + b", type_str + "(0)", group_size); break;
+            case Min:    setup(data_type_str, "min(a, b)", LimitString(type_str, true), group_size); break;
+            case Max:    setup(data_type_str, "max(a, b)", LimitString(type_str, false), group_size); break;
+            case ArgMin: setup(data_type_str, "<", LimitString(type_str, true), group_size, true); break;
+            case ArgMax: setup(data_type_str, ">", LimitString(type_str, false), group_size, true); break;
+            default: throw std::invalid_argument("unknown ReduceProgram::Operation");
+            }
+        }
+
+        /**
+         * @brief      Setup with the glsl type of value_t, see glsl_type.
+         */
+        inline void setup(
+            Operation operation = Operation::Sum,
+            glm::uvec3 group_size = glm::uvec3(1024,1,1)
+        )
+        {
+            setup(glsl_type<value_t>::storage_name(), operation, group_size);
+        }
+
+        /**
+         * @param[in]  data_type_str  The glsl data type or its storage type,
+         *                            for example "vec4" or "packed_vec3"
+         * @param[in]  operator_str   Associative and commutative glsl
+         *                            expression combining `a` and `b`. If
+         *                            arg is set, the comparison operator
+         *                            selecting `b` over `a`, for example "<"
+         * @param[in]  identity_str   Identity element of the operator
+         * @param[in]  group_size     The group size
+         * @param[in]  arg            Whether to reduce to the index of the
+         *                            selected item instead of its value
+         */
+        inline void setup(
+            const std::string& data_type_str,
+            const std::string& operator_str,
+            const std::string& identity_str,
+            glm::uvec3 group_size,
+            bool arg = false
+        )
+        {
+            m_group_size = group_size;
+            uint32_t group_size_total = m_group_size.x * m_group_size.y * m_group_size.z;
+            uint32_t group_size_pow2 = 1;
+            while (group_size_pow2 < group_size_total) group_size_pow2 <<= 1;
+            // the shuffles read all lanes of a subgroup, partial subgroups
+            // would combine undefined values
+            m_use_subgroups = SubgroupsSupported() && (group_size_total % SubgroupSize() == 0);
+            m_shaders = {Shader(Shader::ShaderType::Compute, code())};
+            const std::string type_str = ValueTypeString(data_type_str);
+            m_shaders[0].setup({
+                {"##TYPE_DECLARATIONS##", glslDeclarations({data_type_str})},
+                {"##STORAGE_TYPE##", data_type_str},
+                {"##PACKED##", (type_str != data_type_str) ? "1" : "0"},
+                {"##DATA_TYPE##", type_str},
+                {"##OPERATOR##", arg ? "a" : operator_str},
+                {"##COMPARE##", arg ? operator_str : "<"},
+                {"##IDENTITY##", identity_str},
+                {"##ARG##", arg ? "1" : "0"},
+                {"##USE_SUBGROUPS##", m_use_subgroups ? "1" : "0"},
+                {"##GROUPSIZE_POW2##", std::to_string(group_size_pow2)},
+                {"##GROUPSIZE_X##", std::to_string(m_group_size.x)},
+                {"##GROUPSIZE_Y##", std::to_string(m_group_size.y)},
+                {"##GROUPSIZE_Z##", std::to_string(m_group_size.z)},
+            });
+            m_partial_values.init();
+            m_partial_indices.init();
+            Program::setup();
+            checkGLError();
+        }
+        void dispatch(uint32_t num_items)
+        {
+            dispatch(num_items, offset_in.get(), offset_out.get());
+        }
+        /**
+         * @brief      Reduce num_items from binding 0 starting at offset_in into
+         *             binding 1 at offset_out.
+         */
+        void dispatch(uint32_t num_items, uint32_t offset_in, uint32_t offset_out)
+        {
+            this->offset_in.set(offset_in);
+            this->offset_out.set(offset_out);
+            if (num_items == 0) return;
+            const uint32_t group_size = m_group_size.x * m_group_size.y * m_group_size.z;
+            // at most group_size partial results, so the second pass needs one group
+            uint32_t groups = num_items / group_size + ((num_items % group_size == 0) ? 0 : 1);
+            if (groups > group_size) groups = group_size;
+            size_t num_partial_values = Std430Items<value_type>(groups);
+            if (m_partial_values.size() < num_partial_values) m_partial_values.resize(num_partial_values);
+            if (m_partial_indices.size() < groups) m_partial_indices.resize(groups);
+            m_partial_values.bufferBase(3);
+            m_partial_indices.bufferBase(4);
+
+            this->num_items.set(num_items);
+            pass.set(0);
+            ComputeProgram::dispatch(groups, 1u, 1u);
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+            this->num_items.set(groups);
+            pass.set(1);
+            ComputeProgram::dispatch(1u, 1u, 1u);
+        }
+        inline std::string code() const
+        {
+            return (
+        R"(
+        #version 440
+        #define USE_SUBGROUPS ##USE_SUBGROUPS##
+        #if USE_SUBGROUPS
+        #extension GL_KHR_shader_subgroup_basic : require
+        #extension GL_KHR_shader_subgroup_shuffle_relative : require
+        #endif
+        #define GROUPSIZE_X ##GROUPSIZE_X##
+        #define GROUPSIZE_Y ##GROUPSIZE_Y##
+        #define GROUPSIZE_Z ##GROUPSIZE_Z##
+        #define GROUPSIZE (GROUPSIZE_X*GROUPSIZE_Y*GROUPSIZE_Z)
+        #define GROUPSIZE_POW2 ##GROUPSIZE_POW2##
+        layout(local_size_x=GROUPSIZE_X, local_size_y=GROUPSIZE_Y, local_size_z=GROUPSIZE_Z) in;
+
+        #define ARG ##ARG##
+        #define PACKED ##PACKED##
+        #define PASS_ITEMS 0
+        #define PASS_PARTIALS 1
+        #define NO_INDEX 0xFFFFFFFFu
+
+        ##TYPE_DECLARATIONS##
+
+        layout (std430, binding = 0) buffer buf_data
+        {
+            ##STORAGE_TYPE## data[];
+        };
+        #if ARG
+        layout (std430, binding = 1) buffer buf_out_index
+        {
+            uint out_index[];
+        };
+        #else
+        layout (std430, binding = 1) buffer buf_out_data
+        {
+            ##STORAGE_TYPE## out_data[];
+        };
+        #endif
+
+        #if PACKED
+        ##DATA_TYPE## load(##STORAGE_TYPE## v) { return ##DATA_TYPE##(v.x, v.y, v.z); }
+        ##STORAGE_TYPE## store(##DATA_TYPE## v) { return ##STORAGE_TYPE##(v.x, v.y, v.z); }
+        #else
+        ##DATA_TYPE## load(##DATA_TYPE## v) { return v; }
+        ##DATA_TYPE## store(##DATA_TYPE## v) { return v; }
+        #endif
+        layout (std430, binding = 3) buffer buf_partial_values
+        {
+            ##DATA_TYPE## partial_values[];
+        };
+        layout (std430, binding = 4) buffer buf_partial_indices
+        {
+            uint partial_indices[];
+        };
+
+        uniform uint num_items;
+        uniform uint offset_in;
+        uniform uint offset_out;
+        uniform uint pass;
+
+        shared ##DATA_TYPE## s_values[GROUPSIZE];
+        shared uint s_indices[GROUPSIZE];
+
+        void combine(inout ##DATA_TYPE## a, inout uint a_idx, ##DATA_TYPE## b, uint b_idx)
+        {
+        #if ARG
+            if ((b ##COMPARE## a) || ((b == a) && (b_idx < a_idx)))
+            {
+                a = b;
+                a_idx = b_idx;
+            }
+        #else
+            a = ##OPERATOR##;
+        #endif
+        }
+
+        // reduce over the work group, result is valid in invocation 0.
+        // must be called in uniform control flow
+        void reduceGroup(inout ##DATA_TYPE## value, inout uint idx, uint local_idx)
+        {
+        #if USE_SUBGROUPS
+            for (uint delta = gl_SubgroupSize / 2; delta > 0; delta >>= 1)
+            {
+                ##DATA_TYPE## other = subgroupShuffleDown(value, delta);
+                uint other_idx = subgroupShuffleDown(idx, delta);
+                combine(value, idx, other, other_idx);
+            }
+            if (gl_SubgroupInvocationID == 0)
+            {
+                s_values[gl_SubgroupID] = value;
+                s_indices[gl_SubgroupID] = idx;
+            }
+            uint count = gl_NumSubgroups;
+        #else
+            s_values[local_idx] = value;
+            s_indices[local_idx] = idx;
+            uint count = GROUPSIZE;
+        #endif
+            barrier();
+            for (uint stride = GROUPSIZE_POW2 / 2; stride > 0; stride >>= 1)
+            {
+                if ((local_idx < stride) && (local_idx + stride < count))
+                {
+                    ##DATA_TYPE## a = s_values[local_idx];
+                    uint a_idx = s_indices[local_idx];
+                    combine(a, a_idx, s_values[local_idx + stride], s_indices[local_idx + stride]);
+                    s_values[local_idx] = a;
+                    s_indices[local_idx] = a_idx;
+                }
+                barrier();
+            }
+            value = s_values[0];
+            idx = s_indices[0];
+        }
+
+        void main() {
+            uint local_idx = gl_LocalInvocationIndex;
+            uint global_idx = local_idx + gl_WorkGroupID.x * GROUPSIZE;
+            uint stride = gl_NumWorkGroups.x * GROUPSIZE;
+
+            ##DATA_TYPE## value = ##IDENTITY##;
+            uint idx = NO_INDEX;
+            for (uint i = global_idx; i < num_items; i += stride)
+            {
+                if (pass == PASS_ITEMS) combine(value, idx, load(data[offset_in + i]), i);
+                else combine(value, idx, partial_values[i], partial_indices[i]);
+            }
+
+            reduceGroup(value, idx, local_idx);
+            if (local_idx != 0) return;
+
+            if (pass == PASS_ITEMS)
+            {
+                partial_values[gl_WorkGroupID.x] = value;
+                partial_indices[gl_WorkGroupID.x] = idx;
+            }
+            else
+            {
+            #if ARG
+                out_index[offset_out] = idx;
+            #else
+                out_data[offset_out] = store(value);
+            #endif
+            }
+        }
+        )"
+            );
+        }
+        ProgramUniform<uint32_t> num_items;
+        ProgramUniform<uint32_t> offset_in;
+        ProgramUniform<uint32_t> offset_out;
+        ProgramUniform<uint32_t> pass;
+
+        glm::uvec3 group_size() const { return m_group_size; }
+        /**
+         * @brief      Whether setup chose the subgroup reduction.
+         */
+        bool usesSubgroups() const { return m_use_subgroups; }
+
+        /**
+         * @brief      Whether the current context supports the subgroup
+         *             operations used by the reduction in compute shaders.
+         */
+        static bool SubgroupsSupported()
+        {
+            if (!hasExtension("GL_KHR_shader_subgroup")) return false;
+            GLint stages = 0;
+            GLint features = 0;
+            glGetIntegerv(GL_SUBGROUP_SUPPORTED_STAGES_KHR, &stages);
+            glGetIntegerv(GL_SUBGROUP_SUPPORTED_FEATURES_KHR, &features);
+            GLint required = GL_SUBGROUP_FEATURE_BASIC_BIT_KHR | GL_SUBGROUP_FEATURE_SHUFFLE_RELATIVE_BIT_KHR;
+            return ((stages & GL_COMPUTE_SHADER_BIT) != 0) && ((features & required) == required);
+        }
+
+        /**
+         * @brief      Number of invocations in a subgroup, only valid if
+         *             SubgroupsSupported().
+         */
+        static uint32_t SubgroupSize()
+        {
+            GLint size = 0;
+            glGetIntegerv(GL_SUBGROUP_SIZE_KHR, &size);
+            return (size > 0) ? static_cast<uint32_t>(size) : 1u;
+        }
+
+        /**
+         * @brief      Glsl type the values are reduced as, the data type
+         *             without the "packed_" prefix of its storage type.
+         */
+        static std::string ValueTypeString(const std::string& data_type_str)
+        {
+            const std::string prefix = "packed_";
+            if (data_type_str.compare(0, prefix.size(), prefix) == 0) return data_type_str.substr(prefix.size());
+            return data_type_str;
+        }
+
+        /**
+         * @brief      Glsl expression of the largest or smallest value of a
+         *             type, used as identity for min or max.
+         *
+         * @param[in]  type_str  The glsl type, for example "float" or "ivec3"
+         * @param[in]  largest   Whether to return the largest value
+         */
+        static std::string LimitString(const std::string& type_str, bool largest)
+        {
+            std::string limit;
+            char prefix = type_str.empty() ? ' ' : type_str[0];
+            if ((type_str.compare(0, 4, "uint") == 0) || (prefix == 'u'))
+            {
+                limit = largest ? "0xFFFFFFFFu" : "0u";
+            }
+            else if ((type_str.compare(0, 3, "int") == 0) || (prefix == 'i'))
+            {
+                limit = largest ? "0x7FFFFFFF" : "(-0x7FFFFFFF - 1)";
+            }
+            else if ((type_str.compare(0, 6, "double") == 0) || (prefix == 'd'))
+            {
+                limit = largest ? "1.7976931348623157e+308lf" : "-1.7976931348623157e+308lf";
+            }
+            else
+            {
+                limit = largest ? "3.402823466e+38" : "-3.402823466e+38";
+            }
+            return type_str + "(" + limit + ")";
+        }
+
+    protected:
+        void setupUniforms() override
+        {
+            num_items.init(getGlProgram(), "num_items");
+            offset_in.init(getGlProgram(), "offset_in", 0);
+            offset_out.init(getGlProgram(), "offset_out", 0);
+            pass.init(getGlProgram(), "pass", 0);
+        }
+
+        glm::uvec3 m_group_size;
+        bool m_use_subgroups = false;
+        DeviceBuffer<value_type> m_partial_values = DeviceBuffer<value_type>(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_COPY);
+        DeviceBuffer<uint32_t> m_partial_indices = DeviceBuffer<uint32_t>(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_COPY);
+    };
+
+} // namespace compute_programs
+} // namespace gl_classes
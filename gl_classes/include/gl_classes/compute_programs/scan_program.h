@@ -0,0 +1,289 @@
+#pragma once
+
+#include "glm/glm.hpp"
+#include <string>
+#include <vector>
+
+#include "gl_classes/program.h"
+#include "gl_classes/program_uniform.h"
+#include "gl_classes/compute_program.h"
+#include "gl_classes/device_buffer.h"
+#include "gl_classes/shader.h"
+#include "gl_classes/glsl_type.h"
+
+namespace gl_classes {
+namespace compute_programs {
+
+    /**
+     * @brief      Parallel prefix sum (scan) of a buffer.
+     *
+     * Each work group scans one block of GROUPSIZE items in shared memory.
+     * The block totals are scanned recursively in an internal buffer and
+     * added back, so any number of items can be scanned.
+     *
+     *      binding | buffer
+     *      --------|----------------------------------------------
+     *      0       | input data
+     *      1       | output data, may be the same as the input
+     *      2       | internal block sums, bound by dispatch
+     *
+     * @tparam     value_t  Value type, must match data_type_str
+     */
+    template<typename value_t>
+    class ScanProgram : public gl_classes::ComputeProgram
+    {
+    public:
+        using Program = gl_classes::Program;
+        template<class T> using ProgramUniform = gl_classes::ProgramUniform<T>;
+        using ComputeProgram = gl_classes::ComputeProgram;
+        using Shader = gl_classes::Shader;
+
+        using value_type = value_t;
+        inline ScanProgram() : ComputeProgram("ScanProgram") {}
+        inline ~ScanProgram(){}
+
+        /**
+         * @param[in]  data_type_str  The glsl data type, for example "uint"
+         *                            or "vec3"
+         * @param[in]  operator_str   Associative glsl expression combining
+         *                            `a` and `b`, for example "a + b" or
+         *                            "max(a, b)"
+         * @param[in]  identity_str   Identity element of the operator, for
+         *                            example "0" for "a + b"; defaults to
+         *                            data_type_str(0)
+         * @param[in]  group_size     The group size
+         */
+        inline void setup(
+            const std::string& data_type_str,
+            const std::string& operator_str = "a + b",
+            const std::string& identity_str = "",
+            glm::uvec3 group_size = glm::uvec3(1024,1,1)
+        )
+        {
+            m_group_size = group_size;
+            m_shaders = {Shader(Shader::ShaderType::Compute, code())};
+            m_shaders[0].setup({
+                {"##DATA_TYPE##", data_type_str},
+                {"##OPERATOR##", operator_str},
+                {"##IDENTITY##", identity_str.empty() ? (data_type_str + "(0)") : identity_str},
+                {"##GROUPSIZE_X##", std::to_string(m_group_size.x)},
+                {"##GROUPSIZE_Y##", std::to_string(m_group_size.y)},
+                {"##GROUPSIZE_Z##", std::to_string(m_group_size.z)},
+            });
+            m_block_sums.init();
+            Program::setup();
+            checkGLError();
+        }
+        /**
+         * @brief      Setup a sum scan with the glsl type of value_t, see
+         *             glsl_type.
+         */
+        inline void setup(glm::uvec3 group_size = glm::uvec3(1024,1,1))
+        {
+            static_assert(!glsl_type<value_t>::packed, "value type needs a glsl type with matching std430 stride");
+            setup(glsl_type<value_t>::name(), "a + b", "", group_size);
+        }
+        void dispatch(uint32_t num_items)
+        {
+            dispatch(num_items, offset_in.get(), offset_out.get());
+        }
+        /**
+         * @brief      Scan num_items from binding 0 starting at offset_in into
+         *             binding 1 starting at offset_out.
+         */
+        void dispatch(uint32_t num_items, uint32_t offset_in, uint32_t offset_out)
+        {
+            this->offset_in.set(offset_in);
+            this->offset_out.set(offset_out);
+            if (num_items == 0) return;
+
+            const uint64_t group_size = static_cast<uint64_t>(m_group_size.x) * m_group_size.y * m_group_size.z;
+
+            // level 0 scans the data, level l>0 scans the block sums of level l-1
+            // level_offsets[l] is the start of level l in m_block_sums
+            std::vector<uint64_t> level_sizes = { num_items };
+            std::vector<uint64_t> level_offsets = { 0, 0 };
+            while (level_sizes.back() > group_size)
+            {
+                uint64_t num_blocks = numGroups(level_sizes.back(), group_size);
+                level_sizes.push_back(num_blocks);
+                level_offsets.push_back(level_offsets.back() + num_blocks);
+            }
+            // the single block of the last level also writes its total
+            uint64_t num_block_sums = Std430Items<value_type>(level_offsets.back() + 1);
+            if (m_block_sums.size() < num_block_sums)
+            {
+                m_block_sums.resize(num_block_sums);
+            }
+            m_block_sums.bufferBase(2);
+
+            size_t num_levels = level_sizes.size();
+            pass.set(0);
+            for (size_t level = 0; level < num_levels; ++level)
+            {
+                setLevel(level, level_sizes, level_offsets);
+                dispatchGroups(numGroups(level_sizes[level], group_size));
+                glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+            }
+            pass.set(1);
+            for (size_t level = num_levels - 1; level-- > 0; )
+            {
+                setLevel(level, level_sizes, level_offsets);
+                dispatchGroups(numGroups(level_sizes[level], group_size));
+                glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+            }
+        }
+        inline std::string code() const
+        {
+            return (
+        R"(
+        #version 440
+        #define GROUPSIZE_X ##GROUPSIZE_X##
+        #define GROUPSIZE_Y ##GROUPSIZE_Y##
+        #define GROUPSIZE_Z ##GROUPSIZE_Z##
+        #define GROUPSIZE (GROUPSIZE_X*GROUPSIZE_Y*GROUPSIZE_Z)
+        layout(local_size_x=GROUPSIZE_X, local_size_y=GROUPSIZE_Y, local_size_z=GROUPSIZE_Z) in;
+
+        layout (std430, binding = 0) buffer buf_data
+        {
+            ##DATA_TYPE## data[];
+        };
+        layout (std430, binding = 1) buffer buf_out_data
+        {
+            ##DATA_TYPE## out_data[];
+        };
+        layout (std430, binding = 2) buffer buf_block_sums
+        {
+            ##DATA_TYPE## block_sums[];
+        };
+
+        uniform uint num_items;
+        uniform uint offset_in;
+        uniform uint offset_out;
+        uniform uint offset_level;
+        uniform uint offset_block_sums;
+        uniform bool inclusive_level;
+        uniform bool is_block_level;
+        uniform uint pass;
+
+        shared ##DATA_TYPE## partial[GROUPSIZE];
+
+        ##DATA_TYPE## op(##DATA_TYPE## a, ##DATA_TYPE## b)
+        {
+            return ##OPERATOR##;
+        }
+
+        void main() {
+            uint workgroup_idx =
+                gl_WorkGroupID.z * gl_NumWorkGroups.x * gl_NumWorkGroups.y +
+                gl_WorkGroupID.y * gl_NumWorkGroups.x +
+                gl_WorkGroupID.x;
+            uint local_idx = gl_LocalInvocationIndex;
+            uint global_idx = local_idx + workgroup_idx * GROUPSIZE;
+            // excess groups of a dispatch spread over y
+            if (workgroup_idx * GROUPSIZE >= num_items) return;
+            bool in_range = global_idx < num_items;
+
+            if (pass == 1)
+            {
+                // add the scanned block sums of the next level to each block
+                if (!in_range || workgroup_idx == 0) return;
+                ##DATA_TYPE## prefix = block_sums[offset_block_sums + workgroup_idx];
+                if (is_block_level)
+                {
+                    uint idx = offset_level + global_idx;
+                    block_sums[idx] = op(prefix, block_sums[idx]);
+                }
+                else
+                {
+                    uint idx = offset_out + global_idx;
+                    out_data[idx] = op(prefix, out_data[idx]);
+                }
+                return;
+            }
+
+            ##DATA_TYPE## value = ##IDENTITY##;
+            if (in_range)
+            {
+                value = is_block_level
+                    ? block_sums[offset_level + global_idx]
+                    : data[offset_in + global_idx];
+            }
+            partial[local_idx] = value;
+            barrier();
+
+            // inclusive scan of the block in shared memory
+            for (uint stride = 1; stride < GROUPSIZE; stride <<= 1)
+            {
+                ##DATA_TYPE## left = ##IDENTITY##;
+                if (local_idx >= stride) left = partial[local_idx - stride];
+                barrier();
+                if (local_idx >= stride) partial[local_idx] = op(left, partial[local_idx]);
+                barrier();
+            }
+
+            ##DATA_TYPE## result = inclusive_level
+                ? partial[local_idx]
+                : ((local_idx == 0) ? ##IDENTITY## : partial[local_idx - 1]);
+            if (in_range)
+            {
+                if (is_block_level) block_sums[offset_level + global_idx] = result;
+                else out_data[offset_out + global_idx] = result;
+            }
+            if (local_idx == GROUPSIZE - 1)
+            {
+                block_sums[offset_block_sums + workgroup_idx] = partial[local_idx];
+            }
+        }
+        )"
+            );
+        }
+        ProgramUniform<uint32_t> num_items;
+        ProgramUniform<uint32_t> offset_in;
+        ProgramUniform<uint32_t> offset_out;
+        ProgramUniform<uint32_t> offset_level;
+        ProgramUniform<uint32_t> offset_block_sums;
+        ProgramUniform<bool> inclusive_level;
+        ProgramUniform<bool> is_block_level;
+        ProgramUniform<uint32_t> pass;
+
+        bool inclusive() const { return m_inclusive; }
+        ScanProgram<value_type>& inclusive(bool value) { m_inclusive = value; return *this; }
+
+        glm::uvec3 group_size() const { return m_group_size; }
+        const DeviceBuffer<value_type>& block_sums() const { return m_block_sums; }
+
+    protected:
+        void setupUniforms() override
+        {
+            num_items.init(getGlProgram(), "num_items");
+            offset_in.init(getGlProgram(), "offset_in", 0);
+            offset_out.init(getGlProgram(), "offset_out", 0);
+            offset_level.init(getGlProgram(), "offset_level", 0);
+            offset_block_sums.init(getGlProgram(), "offset_block_sums", 0);
+            inclusive_level.init(getGlProgram(), "inclusive_level", true);
+            is_block_level.init(getGlProgram(), "is_block_level", false);
+            pass.init(getGlProgram(), "pass", 0);
+        }
+
+        static uint64_t numGroups(uint64_t num_items, uint64_t group_size)
+        {
+            return num_items / group_size + ((num_items % group_size == 0) ? 0 : 1);
+        }
+        void setLevel(size_t level, const std::vector<uint64_t>& level_sizes, const std::vector<uint64_t>& level_offsets)
+        {
+            num_items.set(static_cast<uint32_t>(level_sizes[level]));
+            is_block_level.set(level > 0);
+            // block sums are always scanned exclusive, giving the offset of each block
+            inclusive_level.set((level == 0) ? m_inclusive : false);
+            offset_level.set(static_cast<uint32_t>(level_offsets[level]));
+            offset_block_sums.set(static_cast<uint32_t>(level_offsets[level + 1]));
+        }
+
+        glm::uvec3 m_group_size;
+        bool m_inclusive = true;
+        DeviceBuffer<value_type> m_block_sums = DeviceBuffer<value_type>(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_COPY);
+    };
+
+} // namespace compute_programs
+} // namespace gl_classes
@@ -7,6 +7,8 @@
 #include "gl_classes/program_uniform.h"
 #include "gl_classes/compute_program.h"
 #include "gl_classes/shader.h"
+#include "gl_classes/glsl_type.h"
+#include "gl_classes/compute_programs/fused_program.h"
 
 namespace gl_classes {
 namespace compute_programs {
@@ -21,8 +23,16 @@ namespace compute_programs {
         using Shader = gl_classes::Shader;
 
         using value_type = value_t;
-        inline SetSequenceProgram(){}
+        inline SetSequenceProgram() : ComputeProgram("SetSequenceProgram") {}
         inline ~SetSequenceProgram(){}
+        /**
+         * @brief      Setup with the glsl type of value_t, see glsl_type.
+         */
+        inline void setup(glm::uvec3 group_size = glm::uvec3(1024,1,1))
+        {
+            static_assert(!glsl_type<value_t>::packed, "value type needs a glsl type with matching std430 stride");
+            setup(glsl_type<value_t>::name(), group_size);
+        }
         inline void setup(const std::string& type_str, glm::uvec3 group_size = glm::uvec3(1024,1,1))
         {
             m_group_size = group_size;
@@ -34,10 +44,6 @@ namespace compute_programs {
                 {"##GROUPSIZE_Z##", std::to_string(m_group_size.z)}
             });
             Program::setup();
-            num_items.init(getGlProgram(), "num_items");
-            offset.init(getGlProgram(), "offset", 0);
-            start.init(getGlProgram(), "start");
-            increment.init(getGlProgram(), "increment");
             checkGLError();
         }            
         
@@ -85,6 +91,27 @@ namespace compute_programs {
         )"
             );
         }            
+        /**
+         * @brief      Element-wise stage for FusedProgram producing
+         *             s_start + type(global_idx) * s_increment, with the
+         *             uniforms start and increment.
+         */
+        static FusedProgram::Stage FusionStage(const std::string& type_str)
+        {
+            FusedProgram::Stage stage;
+            stage.name = "SetSequence";
+            stage.out_type = type_str;
+            stage.declarations = R"(
+        uniform ##TYPE## ##S##start;
+        uniform ##TYPE## ##S##increment;
+            )";
+            stage.body = R"(
+            return ##S##start + ##TYPE##(global_idx)*##S##increment;
+            )";
+            stage.replacements = {{"##TYPE##", type_str}};
+            return stage;
+        }
+
         ProgramUniform<uint32_t> num_items;
         ProgramUniform<uint32_t> offset;
         ProgramUniform<value_type> start;
@@ -93,6 +120,14 @@ namespace compute_programs {
         glm::uvec3 group_size() const { return m_group_size; }
         
     protected:
+        void setupUniforms() override
+        {
+            num_items.init(getGlProgram(), "num_items");
+            offset.init(getGlProgram(), "offset", 0);
+            start.init(getGlProgram(), "start");
+            increment.init(getGlProgram(), "increment");
+        }
+
         glm::uvec3 m_group_size;
     };
 
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include "gl_classes/imgui_gl.h"
+
+namespace gl_classes {
+
+    /**
+     * @brief      Collects GL_KHR_debug messages in a lock-free ring buffer.
+     *
+     * install() registers a glDebugMessageCallback that copies each message,
+     * tagged with the current errorContext(), into a fixed size ring. The
+     * callback may run on a driver thread when debug output is asynchronous,
+     * so writers only use atomics; messages arriving while the ring is full
+     * are counted as dropped. checkGLError() and checkGLErrorFrame() drain
+     * the active log and throw if it contained errors.
+     *
+     * @see https://www.khronos.org/registry/OpenGL-Refpages/gl4/html/glDebugMessageCallback.xhtml
+     */
+    class DebugMessageLog
+    {
+    public:
+        struct Message
+        {
+            GLenum source = 0;
+            GLenum type = 0;
+            GLenum severity = 0;
+            GLuint id = 0;
+            char context[64] = {0};
+            char text[256] = {0};
+
+            bool isError() const { return type == GL_DEBUG_TYPE_ERROR; }
+        };
+
+        /**
+         * @param[in]  capacity  Number of messages the ring can hold
+         */
+        DebugMessageLog(size_t capacity = 256);
+        ~DebugMessageLog();
+
+        /**
+         * @brief      Enable debug output, register the callback and make this
+         *             the active log.
+         *
+         * @param[in]  minSeverity  Messages below this severity are disabled,
+         *                          one of GL_DEBUG_SEVERITY_HIGH, _MEDIUM,
+         *                          _LOW or _NOTIFICATION.
+         *
+         * @return     Whether GL_KHR_debug is available.
+         */
+        bool install(GLenum minSeverity = GL_DEBUG_SEVERITY_MEDIUM);
+        void uninstall();
+
+        /**
+         * @brief      Move all messages out of the ring, in arrival order.
+         */
+        size_t drain(std::vector<Message>& messages);
+
+        /**
+         * @brief      Number of messages lost because the ring was full.
+         */
+        uint64_t numDropped() const { return m_dropped.load(std::memory_order_relaxed); }
+        size_t capacity() const { return m_slots.size(); }
+
+        static std::string Format(const Message& message);
+        static bool Supported();
+
+        /**
+         * @brief      The log drained by the error checks, or nullptr.
+         */
+        static DebugMessageLog* active();
+        static void active(DebugMessageLog* log);
+
+    protected:
+        struct Slot
+        {
+            std::atomic<uint64_t> sequence;
+            Message message;
+        };
+
+        void push(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* text);
+
+        static void GLAPIENTRY Callback(
+            GLenum source, GLenum type, GLuint id, GLenum severity,
+            GLsizei length, const GLchar* message, const void* userParam);
+
+        std::vector<Slot> m_slots;
+        std::atomic<uint64_t> m_write;
+        std::atomic<uint64_t> m_read;
+        std::atomic<uint64_t> m_dropped;
+        bool m_installed;
+    };
+
+} // namespace gl_classes
@@ -23,6 +23,14 @@ namespace gl_classes {
         size_t m_bufferSize;
         bool m_autoBind = false;
 
+        // growth policy, see resize
+        float m_growthFactor = 1.0f;
+        size_t m_sizeGranularity = 4;
+        bool m_preserveContents = false;
+        bool m_immutableStorage = false;
+        GLbitfield m_storageFlags = GL_DYNAMIC_STORAGE_BIT | GL_MAP_READ_BIT | GL_MAP_WRITE_BIT;
+        bool m_hasBufferBase = false; // whether bufferBase(value) was called
+
     public:
         using value_type = value_t;
         static constexpr size_t element_size = sizeof(value_type); 
@@ -94,25 +102,36 @@ namespace gl_classes {
             resize(numItems);
         }
 
+        /**
+         * @brief      Resize the buffer to numItems.
+         *
+         *             The storage only grows, and it grows according to the
+         *             growth policy: to at least growthFactor() times the
+         *             current capacity, rounded up to sizeGranularity()
+         *             bytes. If preserveContents() is set the old contents
+         *             are copied on the device into the new storage,
+         *             otherwise they are discarded.
+         *
+         * @param[in]  numItems   The number of items
+         * @param[in]  update_gl  Whether to reallocate the storage on the
+         *                        device.
+         */
         void resize(size_t numItems, bool update_gl=true)
         {
             m_numItems = numItems;
-            size_t newBufSize = element_size * m_numItems;
-            // align size to 4 bytes
-            if (newBufSize % 4 != 0)
-            {
-                newBufSize += 4 - (newBufSize % 4);
-            }
+            size_t newBufSize = alignedSize(element_size * m_numItems);
             
             if (newBufSize > m_bufferSize)
             {
-                m_bufferSize = newBufSize;
+                size_t grownBufSize = alignedSize(static_cast<size_t>(m_bufferSize * static_cast<double>(m_growthFactor)));
+                if (grownBufSize > newBufSize) newBufSize = grownBufSize;
                 if (update_gl)
                 {
-                    glBindBuffer(m_target, m_buffer);
-                    // std::vector<value_type> data(m_numItems);
-                    // glBufferData(m_target, m_bufferSize, data.data(), m_usage);
-                    glBufferData(m_target, m_bufferSize, NULL, m_usage);
+                    reallocate(newBufSize);
+                }
+                else
+                {
+                    m_bufferSize = newBufSize;
                 }
             }
             else
@@ -120,6 +139,97 @@ namespace gl_classes {
                 //m_bufferSize = newBufSize;
             }
         }
+        /**
+         * @brief      Make sure the storage can hold at least numItems without
+         *             changing size().
+         */
+        void reserve(size_t numItems)
+        {
+            size_t newBufSize = alignedSize(element_size * numItems);
+            if (newBufSize > m_bufferSize)
+            {
+                reallocate(newBufSize);
+            }
+        }
+        /**
+         * @brief      Shrink the storage to the smallest size holding size()
+         *             items.
+         */
+        void shrink_to_fit()
+        {
+            size_t newBufSize = alignedSize(element_size * m_numItems);
+            if (newBufSize < m_bufferSize)
+            {
+                reallocate(newBufSize);
+            }
+        }
+        /**
+         * @return     The number of items the storage can hold.
+         */
+        size_t capacity() const { return m_bufferSize / element_size; }
+        size_t bufferSize() const { return m_bufferSize; }
+
+        float growthFactor() const { return m_growthFactor; }
+        size_t sizeGranularity() const { return m_sizeGranularity; }
+        bool preserveContents() const { return m_preserveContents; }
+        bool immutableStorage() const { return m_immutableStorage; }
+        GLbitfield storageFlags() const { return m_storageFlags; }
+
+        /**
+         * @brief      Minimal factor the storage grows by in resize. The
+         *             default of 1 grows to exactly the requested size, use
+         *             for example 1.5 or 2 for push_back like workloads.
+         */
+        DeviceBuffer<value_type>& growthFactor(float value)
+        {
+            m_growthFactor = value;
+            return *this;
+        }
+        /**
+         * @brief      Storage sizes are rounded up to multiples of this many
+         *             bytes, for example 4096 for page granular allocations.
+         *             Must be a multiple of 4.
+         */
+        DeviceBuffer<value_type>& sizeGranularity(size_t value)
+        {
+            m_sizeGranularity = (value < 4) ? 4 : value;
+            return *this;
+        }
+        /**
+         * @brief      Keep the contents when the storage grows or shrinks,
+         *             using glCopyBufferSubData into the new storage.
+         *             Mutable storage keeps its buffer object, the contents
+         *             go through a temporary buffer, so bufferId() and
+         *             vertex attribute pointers stay valid.
+         */
+        DeviceBuffer<value_type>& preserveContents(bool value)
+        {
+            m_preserveContents = value;
+            return *this;
+        }
+        /**
+         * @brief      Allocate storage with glBufferStorage instead of
+         *             glBufferData. Immutable storage can not be respecified,
+         *             so every reallocation creates a new buffer object and
+         *             bufferId() changes. The last bufferBase(value) binding
+         *             is reissued only if that index still holds the old id;
+         *             otherwise, and for all other references to the old id
+         *             like vertex attribute pointers, the caller must bind
+         *             the buffer again.
+         *
+         * @see https://www.khronos.org/registry/OpenGL-Refpages/gl4/html/glBufferStorage.xhtml
+         *
+         * @param[in]  value  Whether to use immutable storage.
+         * @param[in]  flags  The flags for glBufferStorage. Keep
+         *                    GL_DYNAMIC_STORAGE_BIT to allow upload.
+         */
+        DeviceBuffer<value_type>& immutableStorage(bool value, GLbitfield flags = GL_DYNAMIC_STORAGE_BIT | GL_MAP_READ_BIT | GL_MAP_WRITE_BIT)
+        {
+            m_immutableStorage = value;
+            m_storageFlags = flags;
+            return *this;
+        }
+
         DeviceBuffer<value_type>& bind()
         {
             glBindBuffer(m_target, m_buffer);
@@ -179,6 +289,7 @@ namespace gl_classes {
         {
             glBindBufferBase(m_target, value, m_buffer);
             m_bufferBase = value;
+            m_hasBufferBase = true;
             return *this;
         }
 
@@ -244,7 +355,115 @@ namespace gl_classes {
         
         // GLuint& bufferId() { return m_buffer; }
 
+    protected:
+        size_t alignedSize(size_t numBytes) const
+        {
+            if (numBytes % m_sizeGranularity != 0)
+            {
+                numBytes += m_sizeGranularity - (numBytes % m_sizeGranularity);
+            }
+            return numBytes;
+        }
+
+        void reallocate(size_t newBufSize)
+        {
+            size_t numBytesToKeep = (newBufSize < m_bufferSize) ? newBufSize : m_bufferSize;
+            bool keep = m_preserveContents && (m_buffer != 0) && (numBytesToKeep > 0);
+            if (!m_immutableStorage)
+            {
+                // respecify the existing buffer object, so its id stays valid
+                if (m_buffer == 0) glGenBuffers(1, &m_buffer);
+                GLuint temporary = 0;
+                if (keep)
+                {
+                    glGenBuffers(1, &temporary);
+                    glBindBuffer(GL_COPY_WRITE_BUFFER, temporary);
+                    glBufferData(GL_COPY_WRITE_BUFFER, numBytesToKeep, NULL, GL_STREAM_COPY);
+                    glBindBuffer(GL_COPY_READ_BUFFER, m_buffer);
+                    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, numBytesToKeep);
+                }
+                glBindBuffer(m_target, m_buffer);
+                glBufferData(m_target, newBufSize, NULL, m_usage);
+                if (keep)
+                {
+                    glBindBuffer(GL_COPY_READ_BUFFER, temporary);
+                    glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+                    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, numBytesToKeep);
+                    glDeleteBuffers(1, &temporary);
+                }
+                m_bufferSize = newBufSize;
+                return;
+            }
+            GLuint newBuffer = 0;
+            glGenBuffers(1, &newBuffer);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+            glBufferStorage(GL_COPY_WRITE_BUFFER, newBufSize, NULL, m_storageFlags);
+            if (keep)
+            {
+                glBindBuffer(GL_COPY_READ_BUFFER, m_buffer);
+                glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, numBytesToKeep);
+            }
+            // another buffer may have been bound to the index since
+            bool rebind = m_hasBufferBase && (m_buffer != 0) && (BoundBufferBase(m_target, m_bufferBase) == m_buffer);
+            if (m_buffer != 0) glDeleteBuffers(1, &m_buffer);
+            m_buffer = newBuffer;
+            m_bufferSize = newBufSize;
+            glBindBuffer(m_target, m_buffer);
+            if (rebind) glBindBufferBase(m_target, m_bufferBase, m_buffer);
+        }
+
+        /**
+         * @return     The buffer bound to index of an indexed target, 0 for
+         *             targets without indexed bindings.
+         */
+        static GLuint BoundBufferBase(GLenum target, GLuint index)
+        {
+            GLenum query = GL_NONE;
+            switch (target)
+            {
+            case GL_SHADER_STORAGE_BUFFER:     query = GL_SHADER_STORAGE_BUFFER_BINDING; break;
+            case GL_UNIFORM_BUFFER:            query = GL_UNIFORM_BUFFER_BINDING; break;
+            case GL_ATOMIC_COUNTER_BUFFER:     query = GL_ATOMIC_COUNTER_BUFFER_BINDING; break;
+            case GL_TRANSFORM_FEEDBACK_BUFFER: query = GL_TRANSFORM_FEEDBACK_BUFFER_BINDING; break;
+            default: return 0;
+            }
+            GLint buffer = 0;
+            glGetIntegeri_v(query, index, &buffer);
+            return static_cast<GLuint>(buffer);
+        }
     };
 
+    namespace detail {
+        template <typename buffer_t>
+        auto bufferOffsetBytes(const buffer_t& buffer, int) -> decltype(static_cast<size_t>(buffer.offsetBytes()))
+        {
+            return static_cast<size_t>(buffer.offsetBytes());
+        }
+        template <typename buffer_t>
+        size_t bufferOffsetBytes(const buffer_t&, long) { return 0; }
+
+        template <typename buffer_t>
+        auto bufferRangeBytes(const buffer_t& buffer, int) -> decltype(static_cast<size_t>(buffer.rangeBytes()))
+        {
+            return static_cast<size_t>(buffer.rangeBytes());
+        }
+        template <typename buffer_t>
+        size_t bufferRangeBytes(const buffer_t&, long) { return 0; }
+    } // namespace detail
+
+    /**
+     * @brief      Start of the data of buffer in its buffer object in bytes,
+     *             nonzero for sub-allocated buffers like ArenaBuffer.
+     */
+    template <typename buffer_t>
+    size_t bufferOffsetBytes(const buffer_t& buffer) { return detail::bufferOffsetBytes(buffer, 0); }
+
+    /**
+     * @brief      Number of bytes to bind with glBindBufferRange, 0 if buffer
+     *             uses its whole buffer object.
+     */
+    template <typename buffer_t>
+    size_t bufferRangeBytes(const buffer_t& buffer) { return detail::bufferRangeBytes(buffer, 0); }
+
 } // namespace gl_classes
 
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <map>
+#include <cstddef>
+
+namespace gl_classes {
+
+    /**
+     * @brief      Set of half open item ranges [start, end) that changed,
+     *             kept sorted and disjoint.
+     *
+     * Ranges closer than mergeGap() items are merged into one, trading a
+     * few unchanged items for fewer upload calls.
+     */
+    class DirtyRanges
+    {
+    public:
+        using const_iterator = std::map<size_t, size_t>::const_iterator;
+
+        DirtyRanges(size_t mergeGap = 16)
+            : m_mergeGap(mergeGap)
+        {}
+
+        /**
+         * @brief      Mark num items starting at start.
+         */
+        void add(size_t start, size_t num);
+        /**
+         * @brief      Remove ranges at or beyond size, and cut the range
+         *             containing size.
+         */
+        void truncate(size_t size);
+        void clear() { m_ranges.clear(); }
+        bool empty() const { return m_ranges.empty(); }
+
+        /**
+         * @return     Number of ranges.
+         */
+        size_t size() const { return m_ranges.size(); }
+        /**
+         * @return     Number of items in all ranges.
+         */
+        size_t numItems() const;
+
+        // iterates pairs of start and end
+        const_iterator begin() const { return m_ranges.begin(); }
+        const_iterator end() const { return m_ranges.end(); }
+
+        size_t mergeGap() const { return m_mergeGap; }
+        void mergeGap(size_t value) { m_mergeGap = value; }
+
+    protected:
+        size_t m_mergeGap;
+        std::map<size_t, size_t> m_ranges; // start -> end
+    };
+
+} // namespace gl_classes
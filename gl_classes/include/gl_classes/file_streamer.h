@@ -0,0 +1,146 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "gl_classes/imgui_gl.h"
+#include "gl_classes/device_buffer.h"
+
+namespace gl_classes {
+
+    /**
+     * @brief      Read only memory mapping of a whole file.
+     */
+    class MappedFile
+    {
+    public:
+        MappedFile() {}
+        MappedFile(const std::string& path) { open(path); }
+        ~MappedFile() { close(); }
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        /**
+         * @brief      Map the file, throws std::runtime_error on failure.
+         */
+        void open(const std::string& path);
+        void close();
+
+        /**
+         * @brief      Hint that bytes start to start+num are read soon, so
+         *             the system reads them ahead in the background.
+         */
+        void willNeed(size_t start, size_t num) const;
+        /**
+         * @brief      Hint that bytes start to start+num are not read
+         *             again, so their pages can be dropped.
+         */
+        void dontNeed(size_t start, size_t num) const;
+
+        const uint8_t* data() const { return m_data; }
+        size_t size() const { return m_size; }
+        bool isOpen() const { return m_open; }
+
+    protected:
+        const uint8_t* m_data = nullptr;
+        size_t m_size = 0;
+        bool m_open = false;
+#ifdef _WIN32
+        void* m_file = nullptr;
+        void* m_mapping = nullptr;
+#else
+        int m_fd = -1;
+#endif
+    };
+
+    /**
+     * @brief      Streams files into buffers in fixed size chunks through a
+     *             small pool of persistently mapped staging buffers.
+     *
+     * The file is memory mapped instead of read into a std::vector, so the
+     * peak memory is a few chunks instead of the file size. Each chunk is
+     * copied from the mapping into a free staging buffer, which reads it
+     * from disk, and then copied into the destination with
+     * glCopyBufferSubData behind a fence. While the gpu copies one chunk the
+     * next one is read, and the system reads the chunk after that ahead.
+     *
+     *      FileStreamer streamer;
+     *      auto stats = streamer.load("points.bin", points);
+     *      std::cout << stats.mbPerSecond() << " MB/s" << std::endl;
+     *
+     * Later commands see the data without a barrier, as it is written by
+     * buffer copies.
+     */
+    class FileStreamer
+    {
+    public:
+        struct Statistics
+        {
+            uint64_t bytes = 0;
+            uint64_t chunks = 0;
+            uint64_t waits = 0;    // chunks that waited for a staging buffer
+            double seconds = 0;    // until the gpu finished the last copy
+            double mbPerSecond() const { return (seconds > 0) ? (bytes / 1e6) / seconds : 0.0; } // 10^6 bytes per second
+        };
+
+        /**
+         * @param[in]  chunkSize   Bytes per chunk
+         * @param[in]  numStaging  Number of staging buffers, at least 2 to
+         *                         overlap reading and copying
+         */
+        FileStreamer(size_t chunkSize = 8 * 1024 * 1024, size_t numStaging = 3);
+        ~FileStreamer();
+        FileStreamer(const FileStreamer&) = delete;
+        FileStreamer& operator=(const FileStreamer&) = delete;
+
+        /**
+         * @brief      Copy numBytes of file starting at fileOffset into buffer
+         *             at bufferOffset. The buffer must be large enough.
+         *
+         * @param[in]  numBytes  Number of bytes, npos for the rest of the file
+         */
+        Statistics stream(const MappedFile& file, GLuint buffer, size_t bufferOffset, size_t fileOffset = 0, size_t numBytes = npos);
+        Statistics stream(const std::string& path, GLuint buffer, size_t bufferOffset, size_t fileOffset = 0, size_t numBytes = npos);
+
+        /**
+         * @brief      Resize a DeviceBuffer to the items in the file after
+         *             headerBytes and stream them into it.
+         */
+        template <typename buffer_t>
+        Statistics load(const std::string& path, buffer_t& buffer, size_t headerBytes = 0)
+        {
+            MappedFile file(path);
+            size_t numBytes = (file.size() > headerBytes) ? (file.size() - headerBytes) : 0;
+            buffer.resize(numBytes / buffer_t::element_size);
+            return stream(file, buffer.bufferId(), bufferOffsetBytes(buffer), headerBytes, buffer.size() * buffer_t::element_size);
+        }
+
+        /**
+         * @return     Sum over all calls.
+         */
+        const Statistics& statistics() const { return m_total; }
+        void drawImGui() const;
+
+        size_t chunkSize() const { return m_chunkSize; }
+        size_t numStaging() const { return m_numStaging; }
+
+        static constexpr size_t npos = static_cast<size_t>(-1);
+
+    protected:
+        struct Staging
+        {
+            GLuint buffer = 0;
+            uint8_t* mapped = nullptr;
+            GLsync fence = 0;
+        };
+
+        void init();
+        bool wait(Staging& staging, bool block);
+
+        size_t m_chunkSize;
+        size_t m_numStaging;
+        std::vector<Staging> m_staging;
+        Statistics m_total;
+    };
+
+} // namespace gl_classes
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "glm/glm.hpp"
+#include "gl_classes/imgui_gl.h"
+
+namespace gl_classes {
+
+    /**
+     * @brief      Compile time mapping of C++ types to glsl types.
+     *
+     * Each specialization provides
+     *
+     *      name()          glsl type, for example "vec3"
+     *      storage_name()  glsl type to declare buffers of T with, so the
+     *                      std430 array stride equals sizeof(T)
+     *      size            sizeof(T)
+     *      alignment       std430 base alignment of name()
+     *      std430_stride   std430 array stride of name()
+     *      packed          whether storage_name() differs from name()
+     *      components      number of scalar components
+     *      component_type  GL enum of the scalar type, for example GL_FLOAT
+     *
+     * 3 component vectors have a std430 stride of 4 components, wasting a
+     * quarter of the bandwidth and mismatching the tightly packed glm types.
+     * Their storage type is a struct of three scalars with a stride of 3
+     * components, declared by glslDeclarations(). Programs that only move
+     * data accept these packed types; programs that compute with the values
+     * require types with packed == false.
+     *
+     * Types without specialization fail to compile.
+     */
+    template <typename T>
+    struct glsl_type;
+
+    namespace detail {
+        template <typename T, size_t Alignment, size_t Stride, int Components, GLenum ComponentType>
+        struct glsl_type_info
+        {
+            using type = T;
+            static constexpr size_t size = sizeof(T);
+            static constexpr size_t alignment = Alignment;
+            static constexpr size_t std430_stride = Stride;
+            static constexpr bool packed = (Stride != sizeof(T));
+            static constexpr int components = Components;
+            static constexpr GLenum component_type = ComponentType;
+        };
+        template <typename T, size_t A, size_t S, int C, GLenum CT> constexpr size_t glsl_type_info<T, A, S, C, CT>::size;
+        template <typename T, size_t A, size_t S, int C, GLenum CT> constexpr size_t glsl_type_info<T, A, S, C, CT>::alignment;
+        template <typename T, size_t A, size_t S, int C, GLenum CT> constexpr size_t glsl_type_info<T, A, S, C, CT>::std430_stride;
+        template <typename T, size_t A, size_t S, int C, GLenum CT> constexpr bool glsl_type_info<T, A, S, C, CT>::packed;
+        template <typename T, size_t A, size_t S, int C, GLenum CT> constexpr int glsl_type_info<T, A, S, C, CT>::components;
+        template <typename T, size_t A, size_t S, int C, GLenum CT> constexpr GLenum glsl_type_info<T, A, S, C, CT>::component_type;
+    } // namespace detail
+
+    template<> struct glsl_type<float> : detail::glsl_type_info<float, 4, 4, 1, GL_FLOAT>
+    {
+        static const char* name() { return "float"; }
+        static const char* storage_name() { return name(); }
+    };
+    template<> struct glsl_type<int32_t> : detail::glsl_type_info<int32_t, 4, 4, 1, GL_INT>
+    {
+        static const char* name() { return "int"; }
+        static const char* storage_name() { return name(); }
+    };
+    template<> struct glsl_type<uint32_t> : detail::glsl_type_info<uint32_t, 4, 4, 1, GL_UNSIGNED_INT>
+    {
+        static const char* name() { return "uint"; }
+        static const char* storage_name() { return name(); }
+    };
+    template<> struct glsl_type<double> : detail::glsl_type_info<double, 8, 8, 1, GL_DOUBLE>
+    {
+        static const char* name() { return "double"; }
+        static const char* storage_name() { return name(); }
+    };
+
+    template<> struct glsl_type<glm::vec2> : detail::glsl_type_info<glm::vec2, 8, 8, 2, GL_FLOAT>
+    {
+        static const char* name() { return "vec2"; }
+        static const char* storage_name() { return name(); }
+    };
+    template<> struct glsl_type<glm::vec3> : detail::glsl_type_info<glm::vec3, 16, 16, 3, GL_FLOAT>
+    {
+        static const char* name() { return "vec3"; }
+        static const char* storage_name() { return "packed_vec3"; }
+    };
+    template<> struct glsl_type<glm::vec4> : detail::glsl_type_info<glm::vec4, 16, 16, 4, GL_FLOAT>
+    {
+        static const char* name() { return "vec4"; }
+        static const char* storage_name() { return name(); }
+    };
+
+    template<> struct glsl_type<glm::ivec2> : detail::glsl_type_info<glm::ivec2, 8, 8, 2, GL_INT>
+    {
+        static const char* name() { return "ivec2"; }
+        static const char* storage_name() { return name(); }
+    };
+    template<> struct glsl_type<glm::ivec3> : detail::glsl_type_info<glm::ivec3, 16, 16, 3, GL_INT>
+    {
+        static const char* name() { return "ivec3"; }
+        static const char* storage_name() { return "packed_ivec3"; }
+    };
+    template<> struct glsl_type<glm::ivec4> : detail::glsl_type_info<glm::ivec4, 16, 16, 4, GL_INT>
+    {
+        static const char* name() { return "ivec4"; }
+        static const char* storage_name() { return name(); }
+    };
+
+    template<> struct glsl_type<glm::uvec2> : detail::glsl_type_info<glm::uvec2, 8, 8, 2, GL_UNSIGNED_INT>
+    {
+        static const char* name() { return "uvec2"; }
+        static const char* storage_name() { return name(); }
+    };
+    template<> struct glsl_type<glm::uvec3> : detail::glsl_type_info<glm::uvec3, 16, 16, 3, GL_UNSIGNED_INT>
+    {
+        static const char* name() { return "uvec3"; }
+        static const char* storage_name() { return "packed_uvec3"; }
+    };
+    template<> struct glsl_type<glm::uvec4> : detail::glsl_type_info<glm::uvec4, 16, 16, 4, GL_UNSIGNED_INT>
+    {
+        static const char* name() { return "uvec4"; }
+        static const char* storage_name() { return name(); }
+    };
+
+    template<> struct glsl_type<glm::dvec2> : detail::glsl_type_info<glm::dvec2, 16, 16, 2, GL_DOUBLE>
+    {
+        static const char* name() { return "dvec2"; }
+        static const char* storage_name() { return name(); }
+    };
+    template<> struct glsl_type<glm::dvec3> : detail::glsl_type_info<glm::dvec3, 32, 32, 3, GL_DOUBLE>
+    {
+        static const char* name() { return "dvec3"; }
+        static const char* storage_name() { return "packed_dvec3"; }
+    };
+    template<> struct glsl_type<glm::dvec4> : detail::glsl_type_info<glm::dvec4, 32, 32, 4, GL_DOUBLE>
+    {
+        static const char* name() { return "dvec4"; }
+        static const char* storage_name() { return name(); }
+    };
+
+    template<> struct glsl_type<glm::mat2> : detail::glsl_type_info<glm::mat2, 8, 16, 4, GL_FLOAT>
+    {
+        static const char* name() { return "mat2"; }
+        static const char* storage_name() { return name(); }
+    };
+    template<> struct glsl_type<glm::mat4> : detail::glsl_type_info<glm::mat4, 16, 64, 16, GL_FLOAT>
+    {
+        static const char* name() { return "mat4"; }
+        static const char* storage_name() { return name(); }
+    };
+
+    /**
+     * @brief      Glsl declarations needed for the given storage type names,
+     *             empty if all of them are builtin types.
+     */
+    inline std::string glslDeclarations(const std::vector<std::string>& type_names)
+    {
+        static const char* packed[][2] = {
+            {"packed_vec3", "float"},
+            {"packed_ivec3", "int"},
+            {"packed_uvec3", "uint"},
+            {"packed_dvec3", "double"},
+        };
+        std::string result;
+        for (const auto& item : packed)
+        {
+            bool used = false;
+            for (const auto& type_name : type_names) used = used || (type_name == item[0]);
+            if (!used) continue;
+            result += std::string("struct ") + item[0] + " { "
+                + item[1] + " x; " + item[1] + " y; " + item[1] + " z; };\n";
+        }
+        return result;
+    }
+
+} // namespace gl_classes
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <cstdint>
+#include "gl_classes/imgui_gl.h"
+
+namespace gl_classes {
+
+    /**
+     * @brief      Measures gpu time of named scopes with timestamp queries.
+     *
+     * begin() and end() place a pair of GL_TIMESTAMP queries, taken from a
+     * pool of query objects, so scopes can be nested. Results are read back
+     * in frame() only once they are available and at least latency() frames
+     * old, so profiling never stalls the pipeline.
+     *
+     * While a profiler is active (see active()), ComputeProgram::dispatch
+     * records each dispatch under the name of its program. Recording only
+     * stores the sample in a ring buffer per scope, min, mean, max and p99
+     * are computed when statistics() or drawImGui() ask for them.
+     *
+     * @see https://www.khronos.org/registry/OpenGL-Refpages/gl4/html/glQueryCounter.xhtml
+     */
+    class GpuProfiler
+    {
+    public:
+        struct Statistics
+        {
+            uint64_t count = 0;
+            double last = 0;   // all times in milliseconds
+            double min = 0;
+            double mean = 0;
+            double max = 0;
+            double p99 = 0;
+            std::vector<float> history;
+        };
+
+        /**
+         * @brief      RAII helper timing its lifetime on the active profiler,
+         *             does nothing if there is none.
+         */
+        class Scope
+        {
+        public:
+            Scope(const std::string& name)
+                : m_profiler(active())
+            {
+                if (m_profiler) m_profiler->begin(name);
+            }
+            ~Scope()
+            {
+                if (m_profiler) m_profiler->end();
+            }
+        protected:
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+            GpuProfiler* m_profiler;
+        };
+
+        /**
+         * @param[in]  latency      Number of frames before results are read
+         * @param[in]  historySize  Number of samples kept per scope
+         */
+        GpuProfiler(uint32_t latency = 3, size_t historySize = 256);
+        ~GpuProfiler();
+
+        void begin(const std::string& name);
+        void end();
+
+        /**
+         * @brief      Call once per frame; collects available results.
+         */
+        void frame();
+
+        /**
+         * @brief      Draw an ImGui window with the statistics and a plot
+         *             of the history of each scope.
+         */
+        void drawImGui(const char* title = "GpuProfiler");
+
+        const std::map<std::string, Statistics>& statistics() const
+        {
+            updateStatistics();
+            return m_statistics;
+        }
+        void resetStatistics();
+
+        uint32_t latency() const { return m_latency; }
+        void latency(uint32_t value) { m_latency = value; }
+
+        size_t historySize() const { return m_historySize; }
+        void historySize(size_t value) { m_historySize = value; }
+
+        /**
+         * @brief      Number of query objects allocated so far.
+         */
+        size_t numQueries() const { return m_queries.size(); }
+
+        /**
+         * @brief      The profiler used by ComputeProgram::dispatch, or
+         *             nullptr to disable profiling (default).
+         */
+        static GpuProfiler* active();
+        static void active(GpuProfiler* profiler);
+
+    protected:
+        struct Series
+        {
+            std::vector<float> samples; // ring buffer of the last historySize samples
+            size_t next = 0;            // oldest sample once the ring is full
+            bool changed = false;
+        };
+        struct Pending
+        {
+            std::string name;
+            GLuint begin;
+            GLuint end;
+            uint64_t frame;
+        };
+
+        GLuint acquireQuery();
+        void releaseQuery(GLuint query);
+        void record(const std::string& name, double milliseconds);
+        void updateStatistics() const;
+
+        uint32_t m_latency;
+        size_t m_historySize;
+        uint64_t m_frame;
+
+        std::vector<GLuint> m_queries;
+        std::vector<GLuint> m_freeQueries;
+        std::vector<Pending> m_open;
+        std::deque<Pending> m_pending;
+
+        mutable std::map<std::string, Statistics> m_statistics;
+        mutable std::map<std::string, Series> m_samples;
+        mutable std::vector<float> m_sorted;
+    };
+
+} // namespace gl_classes
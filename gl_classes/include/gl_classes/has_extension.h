@@ -0,0 +1,12 @@
+#pragma once
+#include <string>
+
+namespace gl_classes {
+
+    /**
+     * @brief      Whether the current context supports the extension, for
+     *             example "GL_KHR_debug".
+     */
+    bool hasExtension(const std::string& name);
+
+} // namespace gl_classes
@@ -1,16 +1,28 @@
 #pragma once
 #include "gl_classes/imgui_gl.h"
 #include <vector>
+#include <stdexcept>
+#include <cstdint>
 #include <glm/glm.hpp>
 // #include <opencv2/opencv.hpp>
 
 #include "gl_classes/device_buffer.h"
+#include "gl_classes/mapped_vector.h"
+#include "gl_classes/dirty_ranges.h"
 
 namespace gl_classes {
 
     /**
      * @brief      This class describes a buffer on device (gpu).
      *
+     * With trackDirty(true), upload() only uploads the items marked with
+     * modify(), set() or markDirty() since the last upload, plus items
+     * added at the end. Writes directly to buffer are not tracked.
+     *
+     *      points.trackDirty(true);
+     *      points.modify(i).x += 1;
+     *      points.upload();   // uploads only item i
+     *
      * @tparam     value_t  Value type, for example glm::vec3
      */
     template <typename value_t, typename buffer_t = std::vector<value_t>>
@@ -20,6 +32,7 @@ namespace gl_classes {
     public:
         using value_type = value_t;
         using buffer_type = buffer_t;
+        using DeviceBuffer = gl_classes::DeviceBuffer<value_t>;
 
         //HostDeviceBuffer(const HostDeviceBuffer& other) = default;
         //    //: DeviceBuffer(other)
@@ -49,19 +62,94 @@ namespace gl_classes {
             return *this;
         }
 
+        struct UploadStatistics
+        {
+            uint64_t uploads = 0;        // calls of upload()
+            uint64_t ranges = 0;         // glBufferSubData calls
+            uint64_t bytesUploaded = 0;
+            uint64_t bytesSkipped = 0;   // unchanged bytes not uploaded
+        };
+
+        /**
+         * @brief      Whether upload() only uploads the dirty ranges. Enabling
+         *             marks all items dirty, so the next upload is complete.
+         */
+        bool trackDirty() const { return m_trackDirty; }
+        HostDeviceBuffer& trackDirty(bool value)
+        {
+            m_trackDirty = value;
+            m_dirty.clear();
+            if (value) m_dirty.add(0, buffer.size());
+            return *this;
+        }
+
+        /**
+         * @brief      Access item idx for writing and mark it dirty.
+         */
+        value_type& modify(size_t idx)
+        {
+            m_dirty.add(idx, 1);
+            return buffer[idx];
+        }
+        /**
+         * @brief      Access num items from start for writing and mark them
+         *             dirty.
+         */
+        value_type* modify(size_t start, size_t num)
+        {
+            m_dirty.add(start, num);
+            return buffer.data() + start;
+        }
+        HostDeviceBuffer& set(size_t idx, const value_type& value)
+        {
+            buffer[idx] = value;
+            m_dirty.add(idx, 1);
+            return *this;
+        }
+        HostDeviceBuffer& markDirty(size_t start, size_t num)
+        {
+            m_dirty.add(start, num);
+            return *this;
+        }
+        DirtyRanges& dirty() { return m_dirty; }
+        const DirtyRanges& dirty() const { return m_dirty; }
+
+        const UploadStatistics& uploadStatistics() const { return m_uploadStatistics; }
+        void resetUploadStatistics() { m_uploadStatistics = UploadStatistics(); }
+
         HostDeviceBuffer& upload()
         {
+            ++m_uploadStatistics.uploads;
+            size_t deviceSize = DeviceBuffer::size();
+            size_t deviceBytes = DeviceBuffer::bufferSize();
             if (buffer.size() != DeviceBuffer::size())
             {
                 DeviceBuffer::resize(buffer.size());
             }
-            DeviceBuffer::upload(buffer.data(), 0, buffer.size());
+            bool discarded = (DeviceBuffer::bufferSize() != deviceBytes) && !DeviceBuffer::preserveContents();
+            if (!m_trackDirty || discarded)
+            {
+                uploadRange(0, buffer.size());
+            }
+            else
+            {
+                // items added at the end are new on the device
+                if (buffer.size() > deviceSize) m_dirty.add(deviceSize, buffer.size() - deviceSize);
+                m_dirty.truncate(buffer.size());
+                for (const auto& range : m_dirty)
+                {
+                    uploadRange(range.first, range.second - range.first);
+                }
+                m_uploadStatistics.bytesSkipped += DeviceBuffer::element_size * (buffer.size() - m_dirty.numItems());
+            }
+            m_dirty.clear();
             return *this;
         }
         HostDeviceBuffer& download()
         {
             buffer.resize(DeviceBuffer::size());
             DeviceBuffer::download(buffer.data());
+            m_dirty.clear();
             return *this;
         }
         HostDeviceBuffer& upload(size_t start, size_t num)
@@ -98,7 +186,172 @@ namespace gl_classes {
             DeviceBuffer::download(data, start, num);
             return *this;
         }
+
+    protected:
+        void uploadRange(size_t start, size_t num)
+        {
+            if (num == 0) return;
+            DeviceBuffer::upload(buffer.data() + start, start, num);
+            ++m_uploadStatistics.ranges;
+            m_uploadStatistics.bytesUploaded += DeviceBuffer::element_size * num;
+        }
+
+        bool m_trackDirty = false;
+        DirtyRanges m_dirty;
+        UploadStatistics m_uploadStatistics;
+    };
+
+    /**
+     * @brief      HostDeviceBuffer whose buffer is the persistently mapped
+     *             storage of the device buffer itself.
+     *
+     * Writes to buffer go directly to memory the gpu reads, upload() only
+     * flushes the written range with glFlushMappedBufferRange instead of
+     * copying it with glBufferSubData. The gpu must not use a range while
+     * it is written, for example use NBuffered to rotate buffers.
+     * download() waits for the gpu and makes its writes visible in buffer.
+     *
+     * Growing beyond the capacity reallocates the storage, copies the
+     * flushed contents on the device and maps it again, which changes
+     * buffer.data() and bufferId(). Resize with buffer or resizeDevice, not
+     * with DeviceBuffer::resize.
+     *
+     *      MappedHostDeviceBuffer<glm::vec3> points(GL_ARRAY_BUFFER, GL_STREAM_DRAW, 0, 1 << 20);
+     *      points.init();
+     *      points.buffer.push_back(point);
+     *      points.upload();
+     *
+     * @tparam     value_t  Trivially copyable value type
+     */
+    template <typename value_t>
+    class HostDeviceBuffer<value_t, MappedVector<value_t>> : public DeviceBuffer<value_t>
+    {
+    public:
+        using value_type = value_t;
+        using buffer_type = MappedVector<value_t>;
+        using DeviceBuffer = gl_classes::DeviceBuffer<value_t>;
+
+        static constexpr GLbitfield storage_flags = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_DYNAMIC_STORAGE_BIT;
+        static constexpr GLbitfield map_flags = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_FLUSH_EXPLICIT_BIT;
+
+        HostDeviceBuffer(GLenum target = GL_ARRAY_BUFFER, GLenum usage = GL_STATIC_DRAW, size_t initialSize = 0,  size_t initialCapacity = 1)
+            : DeviceBuffer(target, usage, (initialCapacity > initialSize) ? initialCapacity : initialSize)
+            , buffer(initialSize)
+        {
+            DeviceBuffer::immutableStorage(true, storage_flags);
+            DeviceBuffer::preserveContents(true);
+            buffer.grow = [this](size_t numItems) { reserve(numItems); };
+        }
+        // buffer.grow refers to this
+        HostDeviceBuffer(const HostDeviceBuffer&) = delete;
+        HostDeviceBuffer& operator=(const HostDeviceBuffer&) = delete;
+
+        buffer_type buffer;
+
+        /**
+         * @brief      Allocate the storage with the initial capacity and map
+         *             it.
+         */
+        void init()
+        {
+            size_t numItems = buffer.size();
+            DeviceBuffer::init();
+            map();
+            DeviceBuffer::resize(numItems);
+        }
+
+        /**
+         * @brief      Grow the storage to hold at least numItems, keeping
+         *             the flushed contents.
+         */
+        void reserve(size_t numItems)
+        {
+            if (numItems <= DeviceBuffer::capacity()) return;
+            flush(0, buffer.size());
+            buffer.detach();
+            DeviceBuffer::reserve(numItems);
+            map();
+        }
+
+        /**
+         * @brief      Make writes to buffer items start to start+num visible
+         *             to the gpu.
+         */
+        HostDeviceBuffer& flush(size_t start, size_t num)
+        {
+            if (num == 0) return *this;
+            DeviceBuffer::bind();
+            glFlushMappedBufferRange(DeviceBuffer::target(), DeviceBuffer::element_size * start, DeviceBuffer::element_size * num);
+            return *this;
+        }
+
+        HostDeviceBuffer& resizeDevice()
+        {
+            if (buffer.size() != DeviceBuffer::size())
+            {
+                DeviceBuffer::resize(buffer.size());
+            }
+            return *this;
+        }
+
+        HostDeviceBuffer& upload()
+        {
+            resizeDevice();
+            return flush(0, buffer.size());
+        }
+        HostDeviceBuffer& upload(size_t start, size_t num)
+        {
+            if (start + num > DeviceBuffer::size())
+            {
+                resizeDevice();
+            }
+            return flush(start, num);
+        }
+        HostDeviceBuffer& download()
+        {
+            waitForDevice();
+            buffer.setSize(DeviceBuffer::size());
+            return *this;
+        }
+        HostDeviceBuffer& download(size_t start, size_t num)
+        {
+            return download();
+        }
+        HostDeviceBuffer& upload(const void* data, size_t start, size_t num)
+        {
+            DeviceBuffer::bind();
+            DeviceBuffer::upload(data, start, num);
+            return *this;
+        }
+        HostDeviceBuffer& download(void* data, size_t start, size_t num)
+        {
+            DeviceBuffer::bind();
+            DeviceBuffer::download(data, start, num);
+            return *this;
+        }
+
+    protected:
+        void map()
+        {
+            DeviceBuffer::bind();
+            void* ptr = glMapBufferRange(DeviceBuffer::target(), 0, DeviceBuffer::bufferSize(), map_flags);
+            if (ptr == nullptr)
+            {
+                throw std::runtime_error("HostDeviceBuffer could not map the storage");
+            }
+            buffer.attach(static_cast<value_t*>(ptr), DeviceBuffer::capacity());
+        }
+        void waitForDevice()
+        {
+            // shader writes to persistently mapped memory need a barrier
+            // and must be complete before the host reads them
+            glMemoryBarrier(GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
+            glFinish();
+        }
     };
 
+    template <typename value_t>
+    using MappedHostDeviceBuffer = HostDeviceBuffer<value_t, MappedVector<value_t>>;
+
 } // namespace gl_classes
 
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+
+namespace gl_classes {
+
+    /**
+     * @brief      Layout of the commands read by glDispatchComputeIndirect.
+     *
+     * @see https://www.khronos.org/registry/OpenGL-Refpages/gl4/html/glDispatchComputeIndirect.xhtml
+     */
+    struct DispatchIndirectCommand
+    {
+        uint32_t num_groups_x;
+        uint32_t num_groups_y;
+        uint32_t num_groups_z;
+    };
+
+    /**
+     * @brief      Layout of the commands read by glDrawArraysIndirect.
+     *
+     * @see https://www.khronos.org/registry/OpenGL-Refpages/gl4/html/glDrawArraysIndirect.xhtml
+     */
+    struct DrawArraysIndirectCommand
+    {
+        uint32_t count;
+        uint32_t instance_count;
+        uint32_t first;
+        uint32_t base_instance;
+    };
+
+    static_assert(sizeof(DispatchIndirectCommand) == 3 * sizeof(uint32_t), "DispatchIndirectCommand must be tightly packed");
+    static_assert(sizeof(DrawArraysIndirectCommand) == 4 * sizeof(uint32_t), "DrawArraysIndirectCommand must be tightly packed");
+
+} // namespace gl_classes
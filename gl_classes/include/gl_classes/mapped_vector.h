@@ -0,0 +1,112 @@
+#pragma once
+
+#include <functional>
+#include <stdexcept>
+
+namespace gl_classes {
+
+    /**
+     * @brief      Vector-like view of mapped memory, with the parts of the
+     *             std::vector interface HostDeviceBuffer uses.
+     *
+     * The memory is owned by whoever attach()es it, for example the
+     * persistently mapped HostDeviceBuffer<value_t, MappedVector<value_t>>.
+     * Growing beyond capacity() calls grow, which must attach larger memory
+     * with the contents preserved. Without grow it throws std::length_error.
+     *
+     * @tparam     value_t  Trivially copyable value type
+     */
+    template <typename value_t>
+    class MappedVector
+    {
+    public:
+        using value_type = value_t;
+        using size_type = size_t;
+        using iterator = value_t*;
+        using const_iterator = const value_t*;
+
+        explicit MappedVector(size_t initialSize = 0)
+            : m_data(nullptr)
+            , m_size(initialSize)
+            , m_capacity(0)
+        {}
+
+        /**
+         * @brief      Use capacity items at data, keeping size() if it fits.
+         */
+        void attach(value_t* data, size_t capacity)
+        {
+            m_data = data;
+            m_capacity = capacity;
+            if (m_size > m_capacity) m_size = m_capacity;
+        }
+        void detach()
+        {
+            m_data = nullptr;
+            m_capacity = 0;
+        }
+
+        value_t* data() { return m_data; }
+        const value_t* data() const { return m_data; }
+        size_t size() const { return m_size; }
+        size_t capacity() const { return m_capacity; }
+        bool empty() const { return m_size == 0; }
+
+        value_t& operator[](size_t idx) { return m_data[idx]; }
+        const value_t& operator[](size_t idx) const { return m_data[idx]; }
+        value_t& front() { return m_data[0]; }
+        value_t& back() { return m_data[m_size - 1]; }
+        iterator begin() { return m_data; }
+        iterator end() { return m_data + m_size; }
+        const_iterator begin() const { return m_data; }
+        const_iterator end() const { return m_data + m_size; }
+
+        void reserve(size_t numItems)
+        {
+            if (numItems <= m_capacity) return;
+            if (!grow)
+            {
+                throw std::length_error("MappedVector capacity exceeded");
+            }
+            grow(numItems);
+        }
+        void resize(size_t numItems)
+        {
+            resize(numItems, value_t());
+        }
+        void resize(size_t numItems, const value_t& value)
+        {
+            reserve(numItems);
+            for (size_t i = m_size; i < numItems; ++i) m_data[i] = value;
+            m_size = numItems;
+        }
+        void push_back(const value_t& value)
+        {
+            if (m_size == m_capacity) reserve((m_capacity < 16) ? 16 : 2 * m_capacity);
+            m_data[m_size++] = value;
+        }
+        /**
+         * @brief      Set size() without initializing new items, for memory
+         *             written by the gpu.
+         */
+        void setSize(size_t numItems)
+        {
+            reserve(numItems);
+            m_size = numItems;
+        }
+        void pop_back() { --m_size; }
+        void clear() { m_size = 0; }
+
+        /**
+         * @brief      Called with the required capacity when it exceeds
+         *             capacity().
+         */
+        std::function<void(size_t)> grow;
+
+    protected:
+        value_t* m_data;
+        size_t m_size;
+        size_t m_capacity;
+    };
+
+} // namespace gl_classes
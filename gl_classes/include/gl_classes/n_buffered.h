@@ -0,0 +1,184 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include "gl_classes/imgui_gl.h"
+
+namespace gl_classes {
+
+    /**
+     * @brief      Rotation over N objects, for example buffers, with a fence
+     *             per slot, generalizing PingPong.
+     *
+     * write() returns a slot the gpu has finished with: the next free one in
+     * rotation order, or, if all N slots are busy, the oldest one after
+     * waiting for its fence. After the commands using the slot are issued,
+     * submit() fences it and makes it the read() slot.
+     *
+     *      NBuffered<HostDeviceBuffer<glm::vec3>, 3> positions;
+     *      auto& buffer = positions.write();
+     *      buffer.upload();
+     *      draw(buffer);
+     *      positions.submit();
+     *
+     * @tparam     T     The type of the slots
+     * @tparam     N     The number of slots
+     */
+    template <typename T, size_t N>
+    class NBuffered
+    {
+    public:
+        static_assert(N > 0, "NBuffered needs at least one slot");
+
+        struct Statistics
+        {
+            uint64_t acquires = 0;
+            uint64_t waits = 0;    // acquires that blocked because all slots were busy
+            double waitMs = 0;     // total time spent blocking
+        };
+
+        NBuffered()
+            : m_readIdx(0)
+            , m_writeIdx(0)
+            , m_acquired(false)
+            , m_age(0)
+            , m_waitTimeout(1000000000) // 1s
+        {
+            m_fences.fill(nullptr);
+            m_submitted.fill(0);
+        }
+        ~NBuffered()
+        {
+            for (GLsync& sync : m_fences)
+            {
+                if (sync != nullptr) glDeleteSync(sync);
+            }
+        }
+        NBuffered(const NBuffered&) = delete;
+        NBuffered& operator=(const NBuffered&) = delete;
+
+        /**
+         * @brief      Acquire a slot the gpu has finished with, blocks only if
+         *             all slots are busy. Returns the same slot until
+         *             submit().
+         */
+        T& write()
+        {
+            if (m_acquired) return m_slots[m_writeIdx];
+            ++m_statistics.acquires;
+            size_t oldest = N;
+            for (size_t k = 1; k <= N; ++k)
+            {
+                size_t idx = (m_writeIdx + k) % N;
+                if (!isBusy(idx))
+                {
+                    m_writeIdx = idx;
+                    m_acquired = true;
+                    return m_slots[idx];
+                }
+                if ((oldest == N) || (m_submitted[idx] < m_submitted[oldest])) oldest = idx;
+            }
+            ++m_statistics.waits;
+            auto start = std::chrono::steady_clock::now();
+            wait(oldest);
+            m_statistics.waitMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            m_writeIdx = oldest;
+            m_acquired = true;
+            return m_slots[oldest];
+        }
+
+        /**
+         * @brief      Fence the slot returned by write() after the commands
+         *             using it and make it the read() slot.
+         */
+        void submit()
+        {
+            if (!m_acquired) write();
+            GLsync& sync = m_fences[m_writeIdx];
+            if (sync != nullptr) glDeleteSync(sync);
+            sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            m_submitted[m_writeIdx] = ++m_age;
+            m_readIdx = m_writeIdx;
+            m_acquired = false;
+        }
+
+        /**
+         * @brief      The most recently submitted slot.
+         */
+        T& read() { return m_slots[m_readIdx]; }
+        const T& read() const { return m_slots[m_readIdx]; }
+
+        /**
+         * @brief      Whether the gpu may still use slot idx, does not block.
+         */
+        bool isBusy(size_t idx)
+        {
+            GLsync& sync = m_fences[idx];
+            if (sync == nullptr) return false;
+            GLenum result = glClientWaitSync(sync, 0, 0);
+            if (result == GL_WAIT_FAILED)
+            {
+                throw std::runtime_error("glClientWaitSync failed");
+            }
+            if (result == GL_TIMEOUT_EXPIRED) return true;
+            glDeleteSync(sync);
+            sync = nullptr;
+            return false;
+        }
+        size_t numBusy()
+        {
+            size_t count = 0;
+            for (size_t i = 0; i < N; ++i) count += isBusy(i) ? 1 : 0;
+            return count;
+        }
+
+        T& get(size_t idx) { return m_slots[idx]; }
+        const T& get(size_t idx) const { return m_slots[idx]; }
+        T& operator[] (size_t idx) { return m_slots[idx]; }
+        const T& operator[] (size_t idx) const { return m_slots[idx]; }
+        size_t readIndex() const { return m_readIdx; }
+        size_t writeIndex() const { return m_writeIdx; }
+        static constexpr size_t size() { return N; }
+
+        const Statistics& statistics() const { return m_statistics; }
+        void resetStatistics() { m_statistics = Statistics(); }
+
+        /**
+         * @brief      Timeout in nanoseconds for each glClientWaitSync call.
+         */
+        GLuint64 waitTimeout() const { return m_waitTimeout; }
+        void waitTimeout(GLuint64 value) { m_waitTimeout = value; }
+
+    protected:
+        void wait(size_t idx)
+        {
+            GLsync& sync = m_fences[idx];
+            if (sync == nullptr) return;
+            GLenum result;
+            do
+            {
+                result = glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, m_waitTimeout);
+            }
+            while (result == GL_TIMEOUT_EXPIRED);
+            glDeleteSync(sync);
+            sync = nullptr;
+            if (result == GL_WAIT_FAILED)
+            {
+                throw std::runtime_error("glClientWaitSync failed");
+            }
+        }
+
+        std::array<T, N> m_slots;
+        std::array<GLsync, N> m_fences;
+        std::array<uint64_t, N> m_submitted;
+        size_t m_readIdx;
+        size_t m_writeIdx;
+        bool m_acquired;
+        uint64_t m_age;
+        GLuint64 m_waitTimeout;
+        Statistics m_statistics;
+    };
+
+} // namespace gl_classes
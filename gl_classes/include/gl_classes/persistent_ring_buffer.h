@@ -0,0 +1,276 @@
+#pragma once
+#include "gl_classes/imgui_gl.h"
+#include <vector>
+#include <stdexcept>
+
+namespace gl_classes {
+
+    /**
+     * @brief      Persistently and coherently mapped buffer on device (gpu),
+     *             split into a ring of regions for streaming per-frame data.
+     *
+     * Storage is allocated once with glBufferStorage and stays mapped. Each
+     * call to next() hands out the following region for writing, waiting
+     * only if the gpu has not yet passed the fence placed on that region the
+     * last time it was used. After issuing the gpu commands that read the
+     * current region call fence().
+     *
+     * bind(), bufferBase() and cbufferBase() refer to the current region, so
+     * compute programs index it from zero like a regular DeviceBuffer.
+     *
+     * @see https://www.khronos.org/registry/OpenGL-Refpages/gl4/html/glBufferStorage.xhtml
+     *
+     * @tparam     value_t  Value type, for example glm::vec3
+     */
+    template <typename value_t>
+    class PersistentRingBuffer
+    {
+    protected:
+        GLenum m_target;
+        GLuint m_buffer;
+
+        GLuint m_bufferBase;
+
+        size_t m_numRegions;
+        size_t m_regionCapacity;
+        size_t m_regionStride; // in bytes, multiple of the offset alignment of m_target
+        size_t m_bufferSize;
+
+        size_t m_region;
+        size_t m_numItems;
+
+        uint8_t* m_mapped;
+        std::vector<GLsync> m_fences;
+
+        uint64_t m_numWaits;
+        GLuint64 m_waitTimeout;
+
+    public:
+        using value_type = value_t;
+        static constexpr size_t element_size = sizeof(value_type);
+
+        /**
+         * @brief      Constructs a new PersistentRingBuffer.
+         *
+         * @param[in]  target          The buffer binding target, for example
+         *                             GL_SHADER_STORAGE_BUFFER.
+         * @param[in]  numRegions      The number of regions in the ring, i.e.
+         *                             how many frames can be in flight.
+         * @param[in]  regionCapacity  The capacity of each region in items
+         */
+        PersistentRingBuffer(GLenum target = GL_SHADER_STORAGE_BUFFER, size_t numRegions = 3, size_t regionCapacity = 1)
+            : m_target(target)
+            , m_buffer(0)
+            , m_bufferBase(0)
+            , m_numRegions(numRegions)
+            , m_regionCapacity(regionCapacity)
+            , m_regionStride(0)
+            , m_bufferSize(0)
+            , m_region(0)
+            , m_numItems(0)
+            , m_mapped(nullptr)
+            , m_numWaits(0)
+            , m_waitTimeout(1000000000) // 1s
+        {}
+
+        void init()
+        {
+            init(m_numRegions, m_regionCapacity);
+        }
+
+        /**
+         * @brief      Allocate the immutable storage and map it.
+         *
+         *             Can only be called once per buffer, as storage
+         *             allocated with glBufferStorage can not be resized.
+         *
+         * @param[in]  numRegions      The number of regions
+         * @param[in]  regionCapacity  The capacity of each region in items
+         */
+        void init(size_t numRegions, size_t regionCapacity)
+        {
+            if (m_buffer != 0)
+            {
+                throw std::runtime_error("PersistentRingBuffer already initialized");
+            }
+            m_numRegions = numRegions;
+            m_regionCapacity = regionCapacity;
+
+            size_t alignment = offsetAlignment(m_target);
+            m_regionStride = element_size * m_regionCapacity;
+            if (m_regionStride % alignment != 0)
+            {
+                m_regionStride += alignment - (m_regionStride % alignment);
+            }
+            m_bufferSize = m_regionStride * m_numRegions;
+
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glGenBuffers(1, &m_buffer);
+            glBindBuffer(m_target, m_buffer);
+            glBufferStorage(m_target, m_bufferSize, NULL, flags);
+            m_mapped = static_cast<uint8_t*>(glMapBufferRange(m_target, 0, m_bufferSize, flags));
+            if (m_mapped == nullptr)
+            {
+                throw std::runtime_error("could not map PersistentRingBuffer");
+            }
+            m_fences.assign(m_numRegions, nullptr);
+            m_region = m_numRegions - 1;
+            m_numItems = 0;
+        }
+
+        /**
+         * @brief      Advance to the next region and return it for writing.
+         *
+         *             Blocks until the gpu is done with the region if it was
+         *             fenced and the fence is not yet signaled.
+         *
+         * @param[in]  numItems  The number of items that will be written,
+         *                       at most regionCapacity().
+         *
+         * @return     Pointer to the mapped region.
+         */
+        value_type* next(size_t numItems)
+        {
+            if (numItems > m_regionCapacity)
+            {
+                throw std::runtime_error("PersistentRingBuffer region capacity exceeded");
+            }
+            m_region = (m_region + 1) % m_numRegions;
+            m_numItems = numItems;
+            wait(m_region);
+            return data();
+        }
+
+        /**
+         * @brief      Place a fence after the gpu commands reading the current
+         *             region. The region is handed out again only after the
+         *             fence is signaled.
+         */
+        PersistentRingBuffer<value_type>& fence()
+        {
+            GLsync& sync = m_fences[m_region];
+            if (sync != nullptr) glDeleteSync(sync);
+            sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            return *this;
+        }
+
+        PersistentRingBuffer<value_type>& bind()
+        {
+            glBindBuffer(m_target, m_buffer);
+            return *this;
+        }
+        const PersistentRingBuffer<value_type>& bind() const
+        {
+            glBindBuffer(m_target, m_buffer);
+            return *this;
+        }
+
+        /**
+         * Binds the current region with glBindBufferRange.
+         * Only if m_target is one of GL_ATOMIC_COUNTER_BUFFER, GL_TRANSFORM_FEEDBACK_BUFFER, GL_UNIFORM_BUFFER or GL_SHADER_STORAGE_BUFFER.
+         * @see https://www.khronos.org/registry/OpenGL-Refpages/gl4/html/glBindBufferRange.xhtml
+         */
+        PersistentRingBuffer<value_type>& bufferBase(GLuint value)
+        {
+            cbufferBase(value);
+            m_bufferBase = value;
+            return *this;
+        }
+        const PersistentRingBuffer<value_type>& cbufferBase(GLuint value) const
+        {
+            glBindBufferRange(m_target, value, m_buffer, offsetBytes(), rangeBytes());
+            return *this;
+        }
+        GLuint bufferBase() const
+        {
+            return m_bufferBase;
+        }
+
+        /**
+         * @return     Pointer to the mapped memory of the current region.
+         */
+        value_type* data()
+        {
+            return reinterpret_cast<value_type*>(m_mapped + offsetBytes());
+        }
+        const value_type* data() const
+        {
+            return reinterpret_cast<const value_type*>(m_mapped + offsetBytes());
+        }
+
+        /**
+         * @return     Byte offset of the current region in the buffer, for
+         *             example for glVertexAttribPointer or glDrawArrays.
+         */
+        size_t offsetBytes() const { return m_region * m_regionStride; }
+        /**
+         * @return     Bytes of the current region bound by bufferBase.
+         */
+        size_t rangeBytes() const
+        {
+            // zero sized ranges are not allowed, always bind at least one item
+            return element_size * ((m_numItems > 0) ? m_numItems : 1);
+        }
+        size_t region() const { return m_region; }
+        size_t numRegions() const { return m_numRegions; }
+        size_t regionCapacity() const { return m_regionCapacity; }
+
+        /**
+         * @return     Number of times next() had to wait for the gpu.
+         */
+        uint64_t numWaits() const { return m_numWaits; }
+
+        /**
+         * @brief      Timeout in nanoseconds for each glClientWaitSync call.
+         */
+        GLuint64 waitTimeout() const { return m_waitTimeout; }
+        void waitTimeout(GLuint64 value) { m_waitTimeout = value; }
+
+        GLenum target() const { return m_target; }
+        size_t size() const { return m_numItems; }
+        GLuint getBufferId() const { return m_buffer; }
+        GLuint bufferId() const { return m_buffer; }
+
+        /**
+         * @brief      Minimal offset alignment for glBindBufferRange on the
+         *             given target.
+         */
+        static size_t offsetAlignment(GLenum target)
+        {
+            GLint alignment = 0;
+            switch (target)
+            {
+            case GL_SHADER_STORAGE_BUFFER: glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment); break;
+            case GL_UNIFORM_BUFFER:        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment); break;
+            case GL_TEXTURE_BUFFER:        glGetIntegerv(GL_TEXTURE_BUFFER_OFFSET_ALIGNMENT, &alignment); break;
+            default: break;
+            }
+            // keep at least 4 byte alignment, like DeviceBuffer
+            return (alignment > 4) ? static_cast<size_t>(alignment) : 4;
+        }
+
+    protected:
+        void wait(size_t region)
+        {
+            GLsync& sync = m_fences[region];
+            if (sync == nullptr) return;
+            GLenum result = glClientWaitSync(sync, 0, 0);
+            if (result == GL_TIMEOUT_EXPIRED)
+            {
+                ++m_numWaits;
+                do
+                {
+                    result = glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, m_waitTimeout);
+                }
+                while (result == GL_TIMEOUT_EXPIRED);
+            }
+            glDeleteSync(sync);
+            sync = nullptr;
+            if (result == GL_WAIT_FAILED)
+            {
+                throw std::runtime_error("glClientWaitSync failed");
+            }
+        }
+    };
+
+} // namespace gl_classes
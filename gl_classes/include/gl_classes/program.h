@@ -3,9 +3,13 @@
 #include <string>
 #include <vector>
 #include <utility>
+#include <chrono>
 #include "gl_classes/imgui_gl.h"
 #include "gl_classes/shader.h"
+#include "gl_classes/program_cache.h"
 #include "gl_classes/check_gl_error.h"
+#include "gl_classes/program_uniform.h"
+#include "gl_classes/has_extension.h"
 
 namespace gl_classes {
 
@@ -19,6 +23,9 @@ namespace gl_classes {
             , m_glProgram(other.getGlProgram())
             , m_shaders(other.getShaders())
             , m_valid(other.isValid())
+            , m_pending(other.isPending())
+            , m_async(other.async())
+            , m_cacheKey(other.m_cacheKey)
         {}        
         Program(const std::vector<Shader>& shaders)
             : Program("", shaders)
@@ -30,16 +37,46 @@ namespace gl_classes {
         {}
         virtual ~Program(){}
 
+        /**
+         * @brief      Compile and link the program, then call setupUniforms.
+         *
+         *             If async() is set, compiling and linking are only
+         *             submitted and setup returns immediately. Poll isReady()
+         *             and call finish(), or let use() finish the program.
+         *             Submitting all programs before finishing the first one
+         *             lets the driver compile them in parallel with
+         *             KHR_parallel_shader_compile.
+         */
         virtual void setup()
         {
             m_valid = false;
+            m_pending = false;
             m_glProgram = glCreateProgram();
             if (m_glProgram != 0)
             {
-                m_valid = Link(getGlProgram(), getShaders());
-                if (!m_valid)
+                ProgramCache* cache = ProgramCache::active();
+                m_cacheKey.clear();
+                if (cache != nullptr)
                 {
-                    printSourceWithLineNumbers();
+                    m_cacheKey = cache->key(getShaderCodes());
+                    if (cache->load(getGlProgram(), m_cacheKey))
+                    {
+                        m_valid = true;
+                        setupUniforms();
+                        return;
+                    }
+                    glProgramParameteri(getGlProgram(), GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+                }
+                m_submitTime = std::chrono::steady_clock::now();
+                for (auto& shader : m_shaders)
+                {
+                    if (!shader.isCompiled()) shader.submit();
+                }
+                SubmitLink(getGlProgram(), getShaders());
+                m_pending = true;
+                if (!m_async)
+                {
+                    finish();
                 }
             }
             else
@@ -48,12 +85,115 @@ namespace gl_classes {
             }
         }
 
+        /**
+         * @brief      Whether a submitted program finished compiling and
+         *             linking, so that finish() will not block. Always true
+         *             without KHR_parallel_shader_compile.
+         */
+        bool isReady() const
+        {
+            if (!m_pending || !ParallelCompileSupported()) return true;
+            GLint completed = GL_FALSE;
+            glGetProgramiv(getGlProgram(), GL_COMPLETION_STATUS_KHR, &completed);
+            return completed == GL_TRUE;
+        }
+
+        /**
+         * @brief      Wait for a submitted program, check the compile and link
+         *             results and call setupUniforms.
+         *
+         * @return     Whether the program is valid.
+         */
+        bool finish()
+        {
+            if (!m_pending) return m_valid;
+            m_pending = false;
+            bool shadersValid = true;
+            for (auto& shader : m_shaders)
+            {
+                shadersValid = shader.finish() && shadersValid;
+            }
+            m_valid = shadersValid && CheckLink(getGlProgram());
+            if (!m_valid)
+            {
+                printSourceWithLineNumbers();
+                return false;
+            }
+            ProgramCache* cache = ProgramCache::active();
+            if ((cache != nullptr) && !m_cacheKey.empty())
+            {
+                cache->addCompileSeconds(std::chrono::duration<double>(std::chrono::steady_clock::now() - m_submitTime).count());
+                cache->store(getGlProgram(), m_cacheKey);
+            }
+            setupUniforms();
+            return m_valid;
+        }
+
+        bool isPending() const { return m_pending; }
+        bool async() const { return m_async; }
+        Program& async(bool value)
+        {
+            m_async = value;
+            return *this;
+        }
+
+        /**
+         * @brief      Whether the driver compiles and links in the background,
+         *             see KHR_parallel_shader_compile.
+         */
+        static bool ParallelCompileSupported()
+        {
+            static const bool supported = 
+                hasExtension("GL_KHR_parallel_shader_compile") 
+             || hasExtension("GL_ARB_parallel_shader_compile");
+            return supported;
+        }
+
+        /**
+         * @brief      Allow the driver to use as many threads as it likes for
+         *             background compiling, if supported.
+         */
+        static void MaxShaderCompilerThreads(GLuint count = 0xFFFFFFFF)
+        {
+            if (ParallelCompileSupported())
+            {
+                glMaxShaderCompilerThreadsKHR(count);
+            }
+        }
+
         bool isValid() const { return m_valid; }
         GLuint getGlProgram() const { return m_glProgram; }
         const std::string& getName() const { return m_name; }
+        void setName(const std::string& name) { m_name = name; }
         const std::vector<Shader>& getShaders() const { return m_shaders; }
         std::vector<Shader>& getShaders() { return m_shaders; }
 
+        /**
+         * @brief      Assign a uniform block of the program to a binding of
+         *             GL_UNIFORM_BUFFER, see UniformBlock and UniformArena.
+         *
+         * @return     Whether the block exists in the program.
+         */
+        bool uniformBlockBinding(const std::string& blockName, GLuint binding)
+        {
+            if (m_pending) finish();
+            GLuint index = glGetUniformBlockIndex(getGlProgram(), blockName.c_str());
+            if (index == GL_INVALID_INDEX) return false;
+            glUniformBlockBinding(getGlProgram(), index, binding);
+            return true;
+        }
+
+        std::vector<std::string> getShaderCodes() const
+        {
+            std::vector<std::string> codes;
+            codes.reserve(m_shaders.size());
+            for (const auto& shader : m_shaders)
+            {
+                codes.push_back(Shader::TypeString(shader.getType()) + "\n" + shader.getCode());
+            }
+            return codes;
+        }
+
         Program withoutShaders() const
         {
             Program result;
@@ -78,7 +218,10 @@ namespace gl_classes {
 
         virtual Program& use()
         {
+            if (m_pending) finish();
             glUseProgram(getGlProgram());
+            ProgramUniformBase::Flush(getGlProgram());
+            errorContext(m_name);
             return *this;
         }
 
@@ -92,13 +235,22 @@ namespace gl_classes {
         }
 
         static bool Link(GLuint programId, const std::vector<Shader>& shaders)
+        {
+            SubmitLink(programId, shaders);
+            return CheckLink(programId);
+        }
+
+        static void SubmitLink(GLuint programId, const std::vector<Shader>& shaders)
         {
             for (int i = 0; i < shaders.size(); ++i)
             {
                 glAttachShader(programId, shaders[i].getGlShader());
             }
             glLinkProgram(programId);
+        }
 
+        static bool CheckLink(GLuint programId)
+        {
             GLchar infolog[512];
             glGetProgramInfoLog(programId, 512, nullptr, infolog);
             if (infolog[0] != '\0') 
@@ -112,8 +264,18 @@ namespace gl_classes {
 
 
     protected:
+        /**
+         * @brief      Called once the program is linked, to look up uniform
+         *             locations and set initial values.
+         */
+        virtual void setupUniforms() {}
+
         bool m_valid;
+        bool m_pending = false;
+        bool m_async = false;
         GLuint m_glProgram;
+        std::string m_cacheKey;
+        std::chrono::steady_clock::time_point m_submitTime;
 
         std::string m_name;
         std::vector<Shader> m_shaders;
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "gl_classes/imgui_gl.h"
+
+namespace gl_classes {
+
+    /**
+     * @brief      On-disk cache of linked program binaries.
+     *
+     * While a cache is active (see active()), Program::setup first tries to
+     * load the program binary with glProgramBinary. Shaders are only compiled and linked if the
+     * binary is missing or rejected by the driver, and the freshly linked
+     * program is stored with glGetProgramBinary.
+     *
+     * Entries are keyed on the substituted code of all shaders and the GL
+     * vendor, renderer and version strings, so driver updates invalidate
+     * them. The full key is stored in each file and compared on load.
+     *
+     * @see https://www.khronos.org/registry/OpenGL-Refpages/gl4/html/glProgramBinary.xhtml
+     */
+    class ProgramCache
+    {
+    public:
+        struct Statistics
+        {
+            uint64_t hits = 0;
+            uint64_t misses = 0;
+            uint64_t rejected = 0;   // binary found, but driver rejected it
+            uint64_t stores = 0;
+            uint64_t storeFailures = 0;
+            double loadSeconds = 0;    // spent in successful loads
+            double compileSeconds = 0; // spent compiling and linking after a miss
+        };
+
+        /**
+         * @param[in]  directory  Existing directory for the cache files
+         */
+        ProgramCache(const std::string& directory = ".");
+
+        /**
+         * @brief      Load the program binary for key into program.
+         *
+         * @return     Whether the program was loaded and is linked.
+         */
+        bool load(GLuint program, const std::string& key);
+
+        /**
+         * @brief      Store the binary of the linked program under key.
+         *             The program should be linked with
+         *             GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+         */
+        bool store(GLuint program, const std::string& key);
+
+        /**
+         * @brief      Cache key for a program made from the given shader
+         *             codes, including the driver identification.
+         */
+        std::string key(const std::vector<std::string>& codes);
+
+        void addCompileSeconds(double seconds) { m_statistics.compileSeconds += seconds; }
+
+        const Statistics& statistics() const { return m_statistics; }
+        void resetStatistics() { m_statistics = Statistics(); }
+
+        const std::string& directory() const { return m_directory; }
+        void directory(const std::string& value) { m_directory = value; }
+
+        /**
+         * @brief      Whether the driver supports any program binary format.
+         */
+        static bool Supported();
+
+        /**
+         * @brief      The cache used by Shader::setup and Program::setup, or
+         *             nullptr to always compile from source (default).
+         */
+        static ProgramCache* active();
+        static void active(ProgramCache* cache);
+
+    protected:
+        std::string filename(const std::string& key) const;
+        const std::string& driver();
+
+        std::string m_directory;
+        std::string m_driver;
+        Statistics m_statistics;
+    };
+
+} // namespace gl_classes
@@ -1,13 +1,79 @@
 #pragma once
 #include "gl_classes/imgui_gl.h"
 #include <string>
+#include <cstdint>
 #include <glm/glm.hpp>
 // #include <opencv2/opencv.hpp>
 
 namespace gl_classes {
 
+    /**
+     * @brief      Type independent part of ProgramUniform: call counters and
+     *             the list of uniforms with deferred uploads.
+     *
+     * set() skips the gl call if the value did not change since the last
+     * upload. In deferred mode set() only marks the uniform dirty, and all
+     * dirty uniforms of a program are uploaded at once by Flush(), which
+     * Program::use() and ComputeProgram::dispatch call.
+     */
+    class ProgramUniformBase
+    {
+    public:
+        struct Statistics
+        {
+            uint64_t calls = 0;     // glProgramUniform* calls issued
+            uint64_t skipped = 0;   // set() with an unchanged value
+            uint64_t coalesced = 0; // set() on an already dirty uniform
+        };
+
+        ProgramUniformBase() {}
+        ProgramUniformBase(const ProgramUniformBase& other);
+        ProgramUniformBase& operator=(const ProgramUniformBase& other);
+        virtual ~ProgramUniformBase();
+
+        /**
+         * @brief      Upload the pending value now.
+         */
+        void flush();
+        bool isDirty() const { return m_dirty; }
+
+        /**
+         * @brief      Upload the dirty uniforms of glProgram.
+         */
+        static void Flush(GLuint glProgram);
+        static void FlushAll();
+
+        /**
+         * @brief      Whether set() defers uploads until the next Flush(),
+         *             off by default.
+         */
+        static bool Deferred();
+        static void Deferred(bool value);
+
+        static Statistics& GetStatistics();
+        static void ResetStatistics();
+
+    public:
+        GLuint m_glProgram = 0;
+        GLint m_loc = -1;
+        std::string m_name;
+        std::string m_nameZeroed;
+        bool m_enableDebugOutput = false;
+
+    protected:
+        virtual void upload() = 0;
+        // call after m_value changed
+        void changed();
+        void invalidate();
+        // keep a pending deferred upload of other
+        void copyDirty(const ProgramUniformBase& other);
+
+        bool m_valid = false; // m_value matches the program state
+        bool m_dirty = false;
+    };
+
     template <typename T>
-    class ProgramUniform
+    class ProgramUniform : public ProgramUniformBase
     {
     public:
         ProgramUniform() {}
@@ -18,6 +84,7 @@ namespace gl_classes {
         }
         void init(GLuint glProgram, const std::string& name)
         {
+            invalidate();
             m_glProgram = glProgram;
             m_name = name;
             m_nameZeroed = m_name + '\0';
@@ -31,220 +98,107 @@ namespace gl_classes {
                 }
             }
         }
-        void set(const T& value);
+        void set(const T& value)
+        {
+            if (m_valid && (m_value == value))
+            {
+                ++GetStatistics().skipped;
+                return;
+            }
+            m_value = value;
+            if (m_loc != -1)
+            {
+                changed();
+            }
+            else if (m_enableDebugOutput)
+            {
+                std::cout << "location for uniform " << m_name << " not found!" << std::endl;
+            }
+        }
         inline const T& get() const { return m_value; }
 
     public:
         T m_value;
-        GLuint m_glProgram;
-        GLint m_loc = -1;
-        std::string m_name;
-        std::string m_nameZeroed;
-        bool m_enableDebugOutput = false;
+
+    protected:
+        void upload() override;
     };
 
     // full template full specialization is no longer a template. It's a
     // concrete function. As such it needs to be (implicitly or explicitly)
     // declared inline. See https://stackoverflow.com/a/4447057/798588
 
-    template<> inline void ProgramUniform<bool>::set(const bool& value)
+    template<> inline void ProgramUniform<bool>::upload()
     {
-        m_value = value;
-        if (m_loc != -1) 
-        {
-            // https://www.khronos.org/registry/OpenGL-Refpages/gl4/html/glProgramUniform.xhtml
-            // Either the i, ui or f variants may be used to provide values for
-            // uniform variables of type bool, bvec2, bvec3, bvec4, or arrays of
-            // these. The uniform variable will be set to false if the input
-            // value is 0 or 0.0f, and it will be set to true otherwise.
-            glProgramUniform1ui(m_glProgram, m_loc, value ? 1 : 0);
-        }
-        else if (m_enableDebugOutput)
-        {
-            std::cout << "location for uniform " << m_name << " not found!" << std::endl;
-        }
+        // https://www.khronos.org/registry/OpenGL-Refpages/gl4/html/glProgramUniform.xhtml
+        // Either the i, ui or f variants may be used to provide values for
+        // uniform variables of type bool, bvec2, bvec3, bvec4, or arrays of
+        // these. The uniform variable will be set to false if the input
+        // value is 0 or 0.0f, and it will be set to true otherwise.
+        glProgramUniform1ui(m_glProgram, m_loc, m_value ? 1 : 0);
     }
-    template<> inline void ProgramUniform<float>::set(const float& value)
+    template<> inline void ProgramUniform<float>::upload()
     {
-        m_value = value;
-        if (m_loc != -1) 
-        {
-            glProgramUniform1f(m_glProgram, m_loc, m_value);
-        }
-        else if (m_enableDebugOutput)
-        {
-            std::cout << "location for uniform " << m_name << " not found!" << std::endl;
-        }
+        glProgramUniform1f(m_glProgram, m_loc, m_value);
     }
-    template<> inline void ProgramUniform<unsigned>::set(const unsigned& value)
+    template<> inline void ProgramUniform<unsigned>::upload()
     {
-        m_value = value;
-        if (m_loc != -1) 
-        {
-            glProgramUniform1ui(m_glProgram, m_loc, m_value);
-        }
-        else if (m_enableDebugOutput)    {
-            std::cout << "location for uniform " << m_name << " not found!" << std::endl;
-        }
+        glProgramUniform1ui(m_glProgram, m_loc, m_value);
     }
-    template<> inline void ProgramUniform<int>::set(const int& value)
+    template<> inline void ProgramUniform<int>::upload()
     {
-        m_value = value;
-        if (m_loc != -1) 
-        {
-            glProgramUniform1i(m_glProgram, m_loc, m_value);
-        }
-        else if (m_enableDebugOutput)
-        {
-            std::cout << "location for uniform " << m_name << " not found!" << std::endl;
-        }
+        glProgramUniform1i(m_glProgram, m_loc, m_value);
     }
-    template<> inline void ProgramUniform<glm::vec2>::set(const glm::vec2& value)
+    template<> inline void ProgramUniform<glm::vec2>::upload()
     {
-        m_value = value;
-        if (m_loc != -1) 
-        {
-            glProgramUniform2fv(m_glProgram, m_loc, 1, &m_value[0]);
-        }
-        else if (m_enableDebugOutput)
-        {
-            std::cout << "location for uniform " << m_name << " not found!" << std::endl;
-        }
+        glProgramUniform2fv(m_glProgram, m_loc, 1, &m_value[0]);
     }
-    template<> inline void ProgramUniform<glm::vec3>::set(const glm::vec3& value)
+    template<> inline void ProgramUniform<glm::vec3>::upload()
     {
-        m_value = value;
-        if (m_loc != -1) 
-        {
-            glProgramUniform3fv(m_glProgram, m_loc, 1, &m_value[0]);
-        }
-        else if (m_enableDebugOutput)
-        {
-            std::cout << "location for uniform " << m_name << " not found!" << std::endl;
-        }
+        glProgramUniform3fv(m_glProgram, m_loc, 1, &m_value[0]);
     }
-    template<> inline void ProgramUniform<glm::vec4>::set(const glm::vec4& value)
+    template<> inline void ProgramUniform<glm::vec4>::upload()
     {
-        m_value = value;
-        if (m_loc != -1) 
-        {
-            glProgramUniform4fv(m_glProgram, m_loc, 1, &m_value[0]);
-        }
-        else if (m_enableDebugOutput)
-        {
-            std::cout << "location for uniform " << m_name << " not found!" << std::endl;
-        }
+        glProgramUniform4fv(m_glProgram, m_loc, 1, &m_value[0]);
     }
-    template<> inline void ProgramUniform<glm::ivec2>::set(const glm::ivec2& value)
+    template<> inline void ProgramUniform<glm::ivec2>::upload()
     {
-        m_value = value;
-        if (m_loc != -1) 
-        {
-            glProgramUniform2iv(m_glProgram, m_loc, 1, &m_value[0]);
-        }
-        else if (m_enableDebugOutput)
-        {
-            std::cout << "location for uniform " << m_name << " not found!" << std::endl;
-        }
+        glProgramUniform2iv(m_glProgram, m_loc, 1, &m_value[0]);
     }
-    template<> inline void ProgramUniform<glm::ivec3>::set(const glm::ivec3& value)
+    template<> inline void ProgramUniform<glm::ivec3>::upload()
     {
-        m_value = value;
-        if (m_loc != -1) 
-        {
-            glProgramUniform3iv(m_glProgram, m_loc, 1, &m_value[0]);
-        }
-        else if (m_enableDebugOutput)
-        {
-            std::cout << "location for uniform " << m_name << " not found!" << std::endl;
-        }
+        glProgramUniform3iv(m_glProgram, m_loc, 1, &m_value[0]);
     }
-    template<> inline void ProgramUniform<glm::ivec4>::set(const glm::ivec4& value)
+    template<> inline void ProgramUniform<glm::ivec4>::upload()
     {
-        m_value = value;
-        if (m_loc != -1) 
-        {
-            glProgramUniform4iv(m_glProgram, m_loc, 1, &m_value[0]);
-        }
-        else if (m_enableDebugOutput)
-        {
-            std::cout << "location for uniform " << m_name << " not found!" << std::endl;
-        }
+        glProgramUniform4iv(m_glProgram, m_loc, 1, &m_value[0]);
     }
-    template<> inline void ProgramUniform<glm::uvec2>::set(const glm::uvec2& value)
+    template<> inline void ProgramUniform<glm::uvec2>::upload()
     {
-        m_value = value;
-        if (m_loc != -1) 
-        {
-            glProgramUniform2uiv(m_glProgram, m_loc, 1, &m_value[0]);
-        }
-        else if (m_enableDebugOutput)
-        {
-            std::cout << "location for uniform " << m_name << " not found!" << std::endl;
-        }
+        glProgramUniform2uiv(m_glProgram, m_loc, 1, &m_value[0]);
     }
-    template<> inline void ProgramUniform<glm::uvec3>::set(const glm::uvec3& value)
+    template<> inline void ProgramUniform<glm::uvec3>::upload()
     {
-        m_value = value;
-        if (m_loc != -1) 
-        {
-            glProgramUniform3uiv(m_glProgram, m_loc, 1, &m_value[0]);
-        }
-        else if (m_enableDebugOutput)
-        {
-            std::cout << "location for uniform " << m_name << " not found!" << std::endl;
-        }
+        glProgramUniform3uiv(m_glProgram, m_loc, 1, &m_value[0]);
     }
-    template<> inline void ProgramUniform<glm::uvec4>::set(const glm::uvec4& value)
+    template<> inline void ProgramUniform<glm::uvec4>::upload()
     {
-        m_value = value;
-        if (m_loc != -1) 
-        {
-            glProgramUniform4uiv(m_glProgram, m_loc, 1, &m_value[0]);
-        }
-        else if (m_enableDebugOutput)
-        {
-            std::cout << "location for uniform " << m_name << " not found!" << std::endl;
-        }
+        glProgramUniform4uiv(m_glProgram, m_loc, 1, &m_value[0]);
     }
-    template<> inline void ProgramUniform<glm::mat2>::set(const glm::mat2& value)
+    template<> inline void ProgramUniform<glm::mat2>::upload()
     {
-        m_value = value;
-        if (m_loc != -1) 
-        {
-            bool transpose = false;
-            glProgramUniformMatrix2fv(m_glProgram, m_loc, 1, transpose, &m_value[0][0]);
-        }
-        else if (m_enableDebugOutput)
-        {
-            std::cout << "location for uniform " << m_name << " not found!" << std::endl;
-        }
+        bool transpose = false;
+        glProgramUniformMatrix2fv(m_glProgram, m_loc, 1, transpose, &m_value[0][0]);
     }
-    template<> inline void ProgramUniform<glm::mat3>::set(const glm::mat3& value)
+    template<> inline void ProgramUniform<glm::mat3>::upload()
     {
-        m_value = value;
-        if (m_loc != -1) 
-        {
-            bool transpose = false;
-            glProgramUniformMatrix3fv(m_glProgram, m_loc, 1, transpose, &m_value[0][0]);
-        }
-        else if (m_enableDebugOutput)
-        {
-            std::cout << "location for uniform " << m_name << " not found!" << std::endl;
-        }
+        bool transpose = false;
+        glProgramUniformMatrix3fv(m_glProgram, m_loc, 1, transpose, &m_value[0][0]);
     }
-    template<> inline void ProgramUniform<glm::mat4>::set(const glm::mat4& value)
+    template<> inline void ProgramUniform<glm::mat4>::upload()
     {
-        m_value = value;
-        if (m_loc != -1) 
-        {
-            bool transpose = false;
-            glProgramUniformMatrix4fv(m_glProgram, m_loc, 1, transpose, &m_value[0][0]);
-        }
-        else if (m_enableDebugOutput)
-        {
-            std::cout << "location for uniform " << m_name << " not found!" << std::endl;
-        }
+        bool transpose = false;
+        glProgramUniformMatrix4fv(m_glProgram, m_loc, 1, transpose, &m_value[0][0]);
     }
     // template<> inline void ProgramUniform<cv::Matx44f>::set(const cv::Matx44f& value)
     // {
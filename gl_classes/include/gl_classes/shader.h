@@ -7,6 +7,7 @@
 #include <stdexcept>
 #include "gl_classes/imgui_gl.h"
 #include "gl_classes/replace_string.h"
+#include "gl_classes/shader_template.h"
 
 namespace gl_classes {
 
@@ -39,6 +40,7 @@ namespace gl_classes {
        
         Shader(const Shader& other)
             : m_valid(other.isValid())
+            , m_pending(other.isPending())
             , m_glShader(other.getGlShader())
             , m_type(other.getType())
             , m_name(other.getName())
@@ -68,18 +70,43 @@ namespace gl_classes {
             , m_glShader(0) // gl shader 0 is invalid shader
         {}
 
+        /**
+         * @brief      Substitute the code template. Compiling is left to
+         *             Program::setup, which submits the shader with the
+         *             program, so async programs compile in the background,
+         *             and skips it if the program binary is cached.
+         */
         void setup(const std::vector<std::pair<std::string, std::string>>& replacements = {})
+        {
+            m_valid = false;
+            m_pending = false;
+            m_glShader = 0;
+            replaceStrings(replacements);
+        }
+
+        /**
+         * @brief      Compile and wait for the result, for shaders used
+         *             without Program::setup.
+         */
+        void compile()
+        {
+            submit();
+            finish();
+        }
+
+        /**
+         * @brief      Start compiling without waiting for the result. With
+         *             KHR_parallel_shader_compile the driver compiles in the
+         *             background until finish() queries the result.
+         */
+        void submit()
         {
             m_valid = false;
             m_glShader = glCreateShader(static_cast<GLenum>(getType()));
             if (m_glShader != 0)
             {
-                replaceStrings(replacements);
-                m_valid = Compile(getGlShader(), getCode());
-                if (!m_valid)
-                {
-                    printSourceWithLineNumbers();
-                }
+                Submit(getGlShader(), getCode());
+                m_pending = true;
             }
             else
             {
@@ -87,12 +114,31 @@ namespace gl_classes {
             }
         }
 
+        /**
+         * @brief      Wait for a submitted compile and check its result.
+         */
+        bool finish()
+        {
+            if (m_pending)
+            {
+                m_pending = false;
+                m_valid = Check(getGlShader());
+                if (!m_valid)
+                {
+                    printSourceWithLineNumbers();
+                }
+            }
+            return m_valid;
+        }
+
         Shader withoutCode() const
         {
             return Shader(getType(), getGlShader(), getName());
         }
 
         bool isValid() const { return m_valid; }
+        bool isCompiled() const { return m_glShader != 0; }
+        bool isPending() const { return m_pending; }
         GLuint getGlShader() const { return m_glShader; }
         ShaderType getType() const { return m_type; }
         const std::string& getName() const { return m_name; }
@@ -112,10 +158,20 @@ namespace gl_classes {
         }
 
         static bool Compile(GLuint shaderId, const std::string& code)
+        {
+            Submit(shaderId, code);
+            return Check(shaderId);
+        }
+
+        static void Submit(GLuint shaderId, const std::string& code)
         {
             char const * codePtr = code.c_str();
             glShaderSource(shaderId, 1, &codePtr , NULL);
             glCompileShader(shaderId);            
+        }
+
+        static bool Check(GLuint shaderId)
+        {
             GLchar infolog[512];
             glGetShaderInfoLog(shaderId, 512, nullptr, infolog);
             if (infolog[0] != '\0') 
@@ -129,6 +185,7 @@ namespace gl_classes {
 
     protected:
         bool m_valid;
+        bool m_pending = false;
         GLuint m_glShader;
         
         ShaderType m_type;
@@ -136,21 +193,9 @@ namespace gl_classes {
         std::string m_codeTemplate;
         std::string m_code;
 
-        void replaceStrings(std::vector<std::pair<std::string,std::string>> replacements)
+        void replaceStrings(const std::vector<std::pair<std::string,std::string>>& replacements)
         {
-            std::string source(m_codeTemplate.cbegin(), m_codeTemplate.cend());
-            std::vector<std::string> removes;
-            std::vector<std::string> inserts;
-            removes.resize(replacements.size());
-            inserts.resize(replacements.size());
-            for (int i = 0; i < replacements.size(); ++i)
-            {
-                removes.push_back(replacements[i].first);
-                inserts.push_back(replacements[i].second);
-            }
-            replace_strings_inplace(source, removes, inserts);
-            m_code.clear();
-            m_code.insert(m_code.end(), source.cbegin(), source.cend());
+            m_code = ShaderTemplate::Get(m_codeTemplate)->render(replacements);
         }
 
     };
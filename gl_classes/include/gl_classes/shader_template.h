@@ -0,0 +1,53 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <utility>
+#include <memory>
+
+namespace gl_classes {
+
+    /**
+     * @brief      Shader code template, tokenized once into text segments and
+     *             ##KEY## placeholders, so that specializations are rendered
+     *             in a single linear pass with one allocation.
+     *
+     * Placeholders are `##` followed by letters, digits or underscores and
+     * `##`. Inserted values are not searched for placeholders again.
+     * Placeholders without a replacement are kept as they are.
+     */
+    class ShaderTemplate
+    {
+    public:
+        using Replacements = std::vector<std::pair<std::string, std::string>>;
+
+        ShaderTemplate(const std::string& code = "");
+
+        void parse(const std::string& code);
+
+        std::string render(const Replacements& replacements) const;
+
+        const std::string& code() const { return m_code; }
+        const std::vector<std::string>& placeholders() const { return m_placeholders; }
+
+        /**
+         * @brief      Parsed template for code, parsed on first use and cached
+         *             for all later calls with the same code.
+         */
+        static std::shared_ptr<const ShaderTemplate> Get(const std::string& code);
+
+        static bool IsPlaceholder(const std::string& key);
+
+    protected:
+        struct Segment
+        {
+            size_t begin;      // of literal text in m_code
+            size_t length;     // of literal text
+            int placeholder;   // index into m_placeholders following the text, or -1
+        };
+
+        std::string m_code;
+        std::vector<Segment> m_segments;
+        std::vector<std::string> m_placeholders;
+    };
+
+} // namespace gl_classes
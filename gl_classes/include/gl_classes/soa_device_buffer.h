@@ -0,0 +1,333 @@
+#pragma once
+#include "gl_classes/imgui_gl.h"
+#include <tuple>
+#include <vector>
+#include <stdexcept>
+#include <glm/glm.hpp>
+
+#include "gl_classes/device_buffer.h"
+#include "gl_classes/vertex_array.h"
+#include "gl_classes/glsl_type.h"
+
+namespace gl_classes {
+
+    namespace detail {
+        template <size_t... Is>
+        struct soa_indices {};
+        template <size_t N, size_t... Is>
+        struct make_soa_indices : make_soa_indices<N-1, N-1, Is...> {};
+        template <size_t... Is>
+        struct make_soa_indices<0, Is...> { using type = soa_indices<Is...>; };
+
+        /**
+         * Number of vertex attribute locations a field occupies, one per
+         * matrix column.
+         */
+        template <typename value_t> struct vertex_columns { static constexpr int value = 1; };
+        template <> struct vertex_columns<glm::mat2> { static constexpr int value = 2; };
+        template <> struct vertex_columns<glm::mat4> { static constexpr int value = 4; };
+    } // namespace detail
+
+    /**
+     * @brief      Structure of arrays: one DeviceBuffer per field with a
+     *             shared number of items, instead of one buffer of structs.
+     *
+     * Passes that only touch one attribute of the points read only that
+     * attribute's buffer. Field I is bound at binding firstBinding + I by
+     * bufferBase(firstBinding), or individually with field<I>().bufferBase.
+     * vertexAttribs() returns the VertexArray::VertexAttribPointers of all
+     * fields. Integer fields arrive as int or uint inputs, double fields as
+     * double inputs, and matrices take one location per column like a mat2
+     * or mat4 input.
+     *
+     * The host side keeps one std::vector per field in host<I>(), which are
+     * contiguous arrays of a single type and thus easy to vectorize.
+     *
+     *      SoADeviceBuffer<glm::vec3, glm::vec3, glm::vec4, uint32_t> points;
+     *      points.init();
+     *      points.resizeHost(n);
+     *      for (size_t i = 0; i < n; ++i) points.host<3>()[i] = label(i);
+     *      points.upload();
+     *      points.bufferBase(0); // positions 0, normals 1, colors 2, labels 3
+     *
+     * @tparam     Fields  Value types of the fields, see glsl_type
+     */
+    template <typename... Fields>
+    class SoADeviceBuffer
+    {
+    public:
+        static constexpr size_t num_fields = sizeof...(Fields);
+        static_assert(num_fields > 0, "SoADeviceBuffer needs at least one field");
+
+        template <size_t I> using field_type = typename std::tuple_element<I, std::tuple<Fields...>>::type;
+        template <size_t I> using buffer_type = DeviceBuffer<field_type<I>>;
+        template <size_t I> using host_type = std::vector<field_type<I>>;
+
+        SoADeviceBuffer(GLenum target = GL_SHADER_STORAGE_BUFFER, GLenum usage = GL_DYNAMIC_DRAW, size_t initialCapacity = 1)
+            : m_buffers(DeviceBuffer<Fields>(target, usage, initialCapacity)...)
+            , m_numItems(initialCapacity)
+        {}
+
+        void init()
+        {
+            apply(InitOp{}, indices());
+        }
+
+        /**
+         * @brief      Resize all fields on the device to numItems.
+         */
+        void resize(size_t numItems)
+        {
+            m_numItems = numItems;
+            apply(ResizeOp{numItems}, indices());
+        }
+        void reserve(size_t numItems)
+        {
+            apply(ReserveOp{numItems}, indices());
+        }
+        /**
+         * @brief      Resize all host arrays to numItems.
+         */
+        void resizeHost(size_t numItems)
+        {
+            apply(ResizeHostOp{numItems}, indices());
+        }
+
+        size_t size() const { return m_numItems; }
+        size_t hostSize() const { return std::get<0>(m_host).size(); }
+        /**
+         * @return     The number of items all fields can hold.
+         */
+        size_t capacity() const
+        {
+            CapacityOp op{static_cast<size_t>(-1)};
+            apply(op, indices());
+            return op.result;
+        }
+
+        template <size_t I> buffer_type<I>& field() { return std::get<I>(m_buffers); }
+        template <size_t I> const buffer_type<I>& field() const { return std::get<I>(m_buffers); }
+
+        template <size_t I> host_type<I>& host() { return std::get<I>(m_host); }
+        template <size_t I> const host_type<I>& host() const { return std::get<I>(m_host); }
+
+        /**
+         * @brief      Bind field I to binding firstBinding + I.
+         */
+        SoADeviceBuffer& bufferBase(GLuint firstBinding)
+        {
+            apply(BufferBaseOp{firstBinding}, indices());
+            return *this;
+        }
+
+        /**
+         * @brief      Upload all host arrays, resizing the device fields to
+         *             their size.
+         */
+        SoADeviceBuffer& upload()
+        {
+            size_t num = hostSize();
+            apply(CheckHostSizeOp{num}, indices());
+            if (num != size()) resize(num);
+            apply(UploadOp{0, num}, indices());
+            return *this;
+        }
+        /**
+         * @brief      Upload items start to start+num of all host arrays.
+         */
+        SoADeviceBuffer& upload(size_t start, size_t num)
+        {
+            if (start + num > size())
+            {
+                return upload();
+            }
+            apply(UploadOp{start, num}, indices());
+            return *this;
+        }
+        /**
+         * @brief      Upload items start to start+num of field I only.
+         */
+        template <size_t I>
+        SoADeviceBuffer& upload(size_t start, size_t num)
+        {
+            field<I>().bind().upload(host<I>().data() + start, start, num);
+            return *this;
+        }
+
+        SoADeviceBuffer& download()
+        {
+            resizeHost(size());
+            apply(DownloadOp{0, size()}, indices());
+            return *this;
+        }
+        template <size_t I>
+        SoADeviceBuffer& download(size_t start, size_t num)
+        {
+            if (host<I>().size() < start + num) host<I>().resize(start + num);
+            field<I>().bind().download(host<I>().data() + start, start, num);
+            return *this;
+        }
+
+        /**
+         * @brief      Vertex attribute reading field I, for fields that are
+         *             not matrices.
+         */
+        template <size_t I>
+        VertexArray::VertexAttribPointer vertexAttrib(GLuint divisor = 0) const
+        {
+            static_assert(detail::vertex_columns<field_type<I>>::value == 1, "matrix fields need one attribute per column, use vertexAttribs");
+            return VertexAttrib<field_type<I>>(field<I>().bufferId(), divisor, 0);
+        }
+        /**
+         * @brief      Vertex attributes of all fields in order. Matrix fields
+         *             add one attribute per column, so the locations of later
+         *             fields shift like the locations of shader inputs.
+         */
+        std::vector<VertexArray::VertexAttribPointer> vertexAttribs(GLuint divisor = 0) const
+        {
+            std::vector<VertexArray::VertexAttribPointer> attribs;
+            attribs.reserve(num_fields);
+            apply(VertexAttribOp{attribs, divisor}, indices());
+            return attribs;
+        }
+
+    protected:
+        using indices_type = typename detail::make_soa_indices<sizeof...(Fields)>::type;
+        static indices_type indices() { return indices_type(); }
+
+        template <typename value_t>
+        static VertexArray::VertexAttribPointer VertexAttrib(GLuint bufferId, GLuint divisor, int column)
+        {
+            using type = glsl_type<value_t>;
+            const int columns = detail::vertex_columns<value_t>::value;
+            const int rows = type::components / columns;
+            const size_t componentSize = sizeof(value_t) / type::components;
+            static_assert(type::components / columns <= 4, "vertex attributes have at most 4 components");
+            VertexArray::VertexAttribPointer attrib(
+                bufferId,
+                rows,
+                type::component_type,
+                static_cast<GLsizei>(componentSize),
+                GL_FALSE,
+                static_cast<GLsizei>(sizeof(value_t)),
+                reinterpret_cast<void*>(column * rows * componentSize),
+                divisor
+            );
+            if (type::component_type == GL_DOUBLE)
+            {
+                attrib.format = VertexArray::VertexAttribPointer::Format::Double;
+            }
+            else if ((type::component_type == GL_INT) || (type::component_type == GL_UNSIGNED_INT))
+            {
+                attrib.format = VertexArray::VertexAttribPointer::Format::Integer;
+            }
+            return attrib;
+        }
+
+        template <typename op_t, size_t... Is>
+        void apply(op_t&& op, detail::soa_indices<Is...>)
+        {
+            int expand[] = {0, (op(std::get<Is>(m_buffers), std::get<Is>(m_host), Is), 0)...};
+            (void)expand;
+        }
+        template <typename op_t, size_t... Is>
+        void apply(op_t&& op, detail::soa_indices<Is...>) const
+        {
+            int expand[] = {0, (op(std::get<Is>(m_buffers), std::get<Is>(m_host), Is), 0)...};
+            (void)expand;
+        }
+
+        struct InitOp
+        {
+            template <typename buffer_t, typename host_t>
+            void operator()(buffer_t& buffer, host_t&, size_t) const { buffer.init(); }
+        };
+        struct ResizeOp
+        {
+            size_t numItems;
+            template <typename buffer_t, typename host_t>
+            void operator()(buffer_t& buffer, host_t&, size_t) const { buffer.resize(numItems); }
+        };
+        struct ReserveOp
+        {
+            size_t numItems;
+            template <typename buffer_t, typename host_t>
+            void operator()(buffer_t& buffer, host_t&, size_t) const { buffer.reserve(numItems); }
+        };
+        struct ResizeHostOp
+        {
+            size_t numItems;
+            template <typename buffer_t, typename host_t>
+            void operator()(buffer_t&, host_t& host, size_t) const { host.resize(numItems); }
+        };
+        struct CheckHostSizeOp
+        {
+            size_t numItems;
+            template <typename buffer_t, typename host_t>
+            void operator()(buffer_t&, host_t& host, size_t) const
+            {
+                if (host.size() != numItems)
+                {
+                    throw std::runtime_error("SoADeviceBuffer: host arrays differ in size");
+                }
+            }
+        };
+        struct CapacityOp
+        {
+            size_t result;
+            template <typename buffer_t, typename host_t>
+            void operator()(const buffer_t& buffer, const host_t&, size_t)
+            {
+                if (buffer.capacity() < result) result = buffer.capacity();
+            }
+        };
+        struct BufferBaseOp
+        {
+            GLuint firstBinding;
+            template <typename buffer_t, typename host_t>
+            void operator()(buffer_t& buffer, host_t&, size_t i) const
+            {
+                buffer.bufferBase(firstBinding + static_cast<GLuint>(i));
+            }
+        };
+        struct UploadOp
+        {
+            size_t start;
+            size_t num;
+            template <typename buffer_t, typename host_t>
+            void operator()(buffer_t& buffer, host_t& host, size_t) const
+            {
+                if (num > 0) buffer.bind().upload(host.data() + start, start, num);
+            }
+        };
+        struct DownloadOp
+        {
+            size_t start;
+            size_t num;
+            template <typename buffer_t, typename host_t>
+            void operator()(buffer_t& buffer, host_t& host, size_t) const
+            {
+                if (num > 0) buffer.bind().download(host.data() + start, start, num);
+            }
+        };
+        struct VertexAttribOp
+        {
+            std::vector<VertexArray::VertexAttribPointer>& attribs;
+            GLuint divisor;
+            template <typename buffer_t, typename host_t>
+            void operator()(const buffer_t& buffer, const host_t&, size_t) const
+            {
+                using value_t = typename buffer_t::value_type;
+                for (int column = 0; column < detail::vertex_columns<value_t>::value; ++column)
+                {
+                    attribs.push_back(VertexAttrib<value_t>(buffer.bufferId(), divisor, column));
+                }
+            }
+        };
+
+        std::tuple<DeviceBuffer<Fields>...> m_buffers;
+        std::tuple<std::vector<Fields>...> m_host;
+        size_t m_numItems;
+    };
+
+} // namespace gl_classes
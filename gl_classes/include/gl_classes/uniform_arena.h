@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include "gl_classes/imgui_gl.h"
+#include "gl_classes/persistent_ring_buffer.h"
+
+namespace gl_classes {
+
+    /**
+     * @brief      Per-frame bump allocator for uniform blocks in one
+     *             persistently mapped GL_UNIFORM_BUFFER.
+     *
+     * Parameter blocks pushed during a frame are written directly into the
+     * mapped region of that frame and bound with glBindBufferRange at their
+     * offset, so hundreds of dispatches share one buffer without any
+     * glBufferSubData. Regions of earlier frames are reused once their fence
+     * is signaled, see PersistentRingBuffer.
+     *
+     *      arena.beginFrame();
+     *      arena.push(params, 0);   // binds at GL_UNIFORM_BUFFER binding 0
+     *      program.dispatch(...);
+     *      arena.endFrame();
+     */
+    class UniformArena
+    {
+    public:
+        struct Allocation
+        {
+            size_t offset = 0; // in bytes, relative to the buffer
+            size_t size = 0;
+        };
+
+        /**
+         * @param[in]  bytesPerFrame  Capacity of each frame
+         * @param[in]  numFrames      Number of frames in flight
+         */
+        UniformArena(size_t bytesPerFrame = 64 * 1024, size_t numFrames = 3)
+            : m_ring(GL_UNIFORM_BUFFER, numFrames, bytesPerFrame)
+            , m_used(0)
+            , m_mapped(nullptr)
+            , m_alignment(0)
+            , m_inFrame(false)
+        {}
+
+        void init()
+        {
+            m_ring.init();
+            m_alignment = PersistentRingBuffer<uint8_t>::offsetAlignment(GL_UNIFORM_BUFFER);
+        }
+
+        /**
+         * @brief      Start writing into the next region, waits if the gpu is
+         *             still reading it.
+         */
+        void beginFrame()
+        {
+            m_mapped = m_ring.next(m_ring.regionCapacity());
+            m_used = 0;
+            m_inFrame = true;
+        }
+
+        /**
+         * @brief      Fence the region after all dispatches using it.
+         */
+        void endFrame()
+        {
+            m_ring.fence();
+            m_inFrame = false;
+        }
+
+        /**
+         * @brief      Reserve size bytes at the uniform buffer offset
+         *             alignment and return a pointer for writing them.
+         */
+        void* allocate(size_t size, Allocation& allocation)
+        {
+            if (!m_inFrame)
+            {
+                throw std::runtime_error("UniformArena::allocate outside of beginFrame/endFrame");
+            }
+            size_t offset = m_used;
+            if (offset % m_alignment != 0) offset += m_alignment - (offset % m_alignment);
+            if (offset + size > m_ring.regionCapacity())
+            {
+                throw std::runtime_error("UniformArena frame capacity exceeded");
+            }
+            m_used = offset + size;
+            allocation.offset = m_ring.offsetBytes() + offset;
+            allocation.size = size;
+            return m_mapped + offset;
+        }
+
+        /**
+         * @brief      Copy params into the frame and bind them at binding.
+         *             params_t must follow the std140 layout of the block.
+         */
+        template<typename params_t>
+        Allocation push(const params_t& params, GLuint binding)
+        {
+            Allocation allocation;
+            void* ptr = allocate(sizeof(params_t), allocation);
+            std::memcpy(ptr, &params, sizeof(params_t));
+            bind(allocation, binding);
+            return allocation;
+        }
+
+        void bind(const Allocation& allocation, GLuint binding) const
+        {
+            glBindBufferRange(GL_UNIFORM_BUFFER, binding, m_ring.bufferId(), allocation.offset, allocation.size);
+        }
+
+        size_t used() const { return m_used; }
+        size_t capacity() const { return m_ring.regionCapacity(); }
+        uint64_t numWaits() const { return m_ring.numWaits(); }
+        GLuint bufferId() const { return m_ring.bufferId(); }
+
+    protected:
+        PersistentRingBuffer<uint8_t> m_ring;
+        size_t m_used;
+        uint8_t* m_mapped;
+        size_t m_alignment;
+        bool m_inFrame;
+    };
+
+} // namespace gl_classes
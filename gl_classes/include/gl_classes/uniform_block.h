@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstring>
+#include "gl_classes/imgui_gl.h"
+#include "gl_classes/device_buffer.h"
+#include "gl_classes/uniform_arena.h"
+
+namespace gl_classes {
+
+    /**
+     * @brief      C++ struct mirrored into an std140 uniform block, uploaded
+     *             with one call instead of one glProgramUniform per member.
+     *
+     * The struct must match the std140 layout of the block: scalars align
+     * to 4 bytes, vec2 to 8, vec3 and vec4 to 16 and the size of the block
+     * is a multiple of 16. Pad explicitly, for example
+     *
+     *      struct Params               // layout(std140) uniform Params
+     *      {                           // {
+     *          uint32_t num_items;     //     uint num_items;
+     *          uint32_t offset_in;     //     uint offset_in;
+     *          uint32_t offset_out;    //     uint offset_out;
+     *          uint32_t pad0;          // };
+     *      };
+     *
+     * and assign the block to a binding with Program::uniformBlockBinding.
+     * upload() skips the upload if the values did not change since the
+     * last one; push() writes them into a UniformArena instead.
+     *
+     * @tparam     params_t  Trivially copyable struct in std140 layout
+     */
+    template <typename params_t>
+    class UniformBlock
+    {
+    public:
+        using value_type = params_t;
+        static_assert(sizeof(params_t) % 16 == 0, "std140 uniform blocks are padded to a multiple of 16 bytes");
+
+        UniformBlock()
+            : params()
+            , m_buffer(GL_UNIFORM_BUFFER, GL_DYNAMIC_DRAW)
+            , m_uploaded(false)
+        {
+            std::memset(&m_uploadedValue, 0, sizeof(params_t));
+        }
+
+        void init()
+        {
+            m_buffer.init();
+            m_buffer.resize(1);
+            m_uploaded = false;
+        }
+
+        /**
+         * @brief      Upload the values to the own buffer if they changed.
+         */
+        UniformBlock<params_t>& upload()
+        {
+            if (m_uploaded && (std::memcmp(&m_uploadedValue, &params, sizeof(params_t)) == 0))
+            {
+                return *this;
+            }
+            m_buffer.bind().upload(&params, 0, 1);
+            std::memcpy(&m_uploadedValue, &params, sizeof(params_t));
+            m_uploaded = true;
+            return *this;
+        }
+
+        /**
+         * @brief      Upload if needed and bind the own buffer at binding.
+         */
+        UniformBlock<params_t>& bufferBase(GLuint binding)
+        {
+            upload();
+            m_buffer.bufferBase(binding);
+            return *this;
+        }
+
+        /**
+         * @brief      Write the values into the current frame of arena and
+         *             bind them at binding.
+         */
+        UniformArena::Allocation push(UniformArena& arena, GLuint binding) const
+        {
+            return arena.push(params, binding);
+        }
+
+        const DeviceBuffer<params_t>& buffer() const { return m_buffer; }
+
+        params_t params;
+
+    protected:
+        DeviceBuffer<params_t> m_buffer;
+        params_t m_uploadedValue;
+        bool m_uploaded;
+    };
+
+} // namespace gl_classes
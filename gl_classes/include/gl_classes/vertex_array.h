@@ -16,6 +16,14 @@ namespace gl_classes {
 
         struct VertexAttribPointer
         {
+            /**
+             * How the shader receives the attribute: Float converts to float
+             * with glVertexAttribPointer, Integer keeps integers for int/uint
+             * inputs with glVertexAttribIPointer, Double keeps doubles with
+             * glVertexAttribLPointer.
+             */
+            enum class Format { Float, Integer, Double };
+
             VertexAttribPointer(
                 GLuint bufferId = 0,
                 GLint size = 1,
@@ -49,14 +57,25 @@ namespace gl_classes {
                 // object must be bound to the GL_ARRAY_BUFFER target (see
                 // glBindBuffer), otherwise an error is generated.
                 glBindBuffer(GL_ARRAY_BUFFER, bufferId);
-                glVertexAttribPointer(
-                    attribId,
-                    size,
-                    type,
-                    normalized,
-                    stride,
-                    offset
-                );
+                switch (format)
+                {
+                case Format::Integer:
+                    glVertexAttribIPointer(attribId, size, type, stride, offset);
+                    break;
+                case Format::Double:
+                    glVertexAttribLPointer(attribId, size, type, stride, offset);
+                    break;
+                default:
+                    glVertexAttribPointer(
+                        attribId,
+                        size,
+                        type,
+                        normalized,
+                        stride,
+                        offset
+                    );
+                    break;
+                }
                 glVertexAttribDivisor(attribId, divisor);
             }
 
@@ -78,6 +97,7 @@ namespace gl_classes {
             GLsizei stride;
             void * offset;
             GLuint divisor;
+            Format format = Format::Float;
         };
 
         VertexArray()
@@ -136,6 +156,7 @@ namespace gl_classes {
                     attr_part.type = attr.type;
                     attr_part.typeSize = attr.typeSize;
                     attr_part.normalized = attr.normalized;
+                    attr_part.format = attr.format;
                     // use stride of actual (unsplitted attr), if it is zero, we must
                     // explicitly put in the implicit stride of the original attr.
                     // otherwise the implicit stride would be calculated from at most 4
@@ -0,0 +1,145 @@
+#include "gl_classes/async_readback.h"
+#include <cstring>
+#include <stdexcept>
+
+namespace gl_classes {
+
+    bool AsyncReadback::Request::ready()
+    {
+        if (!m_state) return false;
+        if (m_state->complete) return true;
+        return m_state->owner->tryComplete(*m_state, 0);
+    }
+
+    void AsyncReadback::Request::wait()
+    {
+        if (!m_state || m_state->complete) return;
+        m_state->owner->tryComplete(*m_state, GL_TIMEOUT_IGNORED);
+    }
+
+    size_t AsyncReadback::Request::numBytes() const
+    {
+        return m_state ? m_state->numBytes : 0;
+    }
+
+    AsyncReadback::AsyncReadback(size_t minStagingSize)
+        : m_minStagingSize(minStagingSize)
+    {}
+
+    AsyncReadback::~AsyncReadback()
+    {
+        finish();
+        for (Staging& staging : m_staging)
+        {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, staging.buffer);
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+            glDeleteBuffers(1, &staging.buffer);
+        }
+    }
+
+    AsyncReadback::Request AsyncReadback::read(GLuint buffer, size_t offsetBytes, size_t numBytes, void* destination)
+    {
+        std::shared_ptr<State> state = std::make_shared<State>();
+        state->owner = this;
+        state->destination = destination;
+        state->numBytes = numBytes;
+        ++m_statistics.requests;
+        m_statistics.bytes += numBytes;
+        if (numBytes == 0)
+        {
+            state->complete = true;
+            return Request(state);
+        }
+        state->staging = acquireStaging(numBytes);
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, m_staging[state->staging].buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offsetBytes, 0, numBytes);
+        state->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        // make sure the fence reaches the gpu, so waiting on it can not hang
+        glFlush();
+        m_pending.push_back(state);
+        return Request(state);
+    }
+
+    void AsyncReadback::poll()
+    {
+        // copies finish in order
+        while (!m_pending.empty())
+        {
+            State& state = *m_pending.front();
+            if (!state.complete && !tryComplete(state, 0)) break;
+            m_pending.pop_front();
+        }
+    }
+
+    void AsyncReadback::finish()
+    {
+        for (auto& state : m_pending)
+        {
+            if (!state->complete) tryComplete(*state, GL_TIMEOUT_IGNORED);
+        }
+        m_pending.clear();
+    }
+
+    size_t AsyncReadback::acquireStaging(size_t numBytes)
+    {
+        size_t best = m_staging.size();
+        for (size_t i = 0; i < m_staging.size(); ++i)
+        {
+            if (m_staging[i].busy || (m_staging[i].size < numBytes)) continue;
+            if ((best == m_staging.size()) || (m_staging[i].size < m_staging[best].size)) best = i;
+        }
+        if (best == m_staging.size())
+        {
+            Staging staging;
+            staging.size = (numBytes < m_minStagingSize) ? m_minStagingSize : numBytes;
+            const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glGenBuffers(1, &staging.buffer);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, staging.buffer);
+            glBufferStorage(GL_COPY_WRITE_BUFFER, staging.size, NULL, flags);
+            staging.mapped = static_cast<uint8_t*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, staging.size, flags));
+            if (staging.mapped == nullptr)
+            {
+                glDeleteBuffers(1, &staging.buffer);
+                throw std::runtime_error("AsyncReadback could not map staging buffer");
+            }
+            m_staging.push_back(staging);
+            m_statistics.numStaging = m_staging.size();
+            m_statistics.stagingBytes += staging.size;
+        }
+        m_staging[best].busy = true;
+        return best;
+    }
+
+    bool AsyncReadback::tryComplete(State& state, GLuint64 timeoutNs)
+    {
+        if (state.complete) return true;
+        GLenum result = glClientWaitSync(state.fence, 0, 0);
+        if ((result == GL_TIMEOUT_EXPIRED) && (timeoutNs > 0))
+        {
+            ++m_statistics.waits;
+            result = glClientWaitSync(state.fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeoutNs);
+        }
+        if (result == GL_WAIT_FAILED)
+        {
+            throw std::runtime_error("AsyncReadback: glClientWaitSync failed");
+        }
+        if ((result != GL_ALREADY_SIGNALED) && (result != GL_CONDITION_SATISFIED)) return false;
+        complete(state);
+        return true;
+    }
+
+    void AsyncReadback::complete(State& state)
+    {
+        Staging& staging = m_staging[state.staging];
+        if (state.destination != nullptr)
+        {
+            std::memcpy(state.destination, staging.mapped, state.numBytes);
+        }
+        glDeleteSync(state.fence);
+        state.fence = 0;
+        staging.busy = false;
+        state.complete = true;
+    }
+
+} // namespace gl_classes
@@ -0,0 +1,167 @@
+#include "gl_classes/buffer_arena.h"
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+namespace gl_classes {
+
+    BufferArena::BufferArena(GLenum target, GLenum usage, size_t blockSize)
+        : m_target(target)
+        , m_usage(usage)
+        , m_blockSize(blockSize)
+        , m_alignment(16)
+        , m_generation(0)
+    {}
+
+    BufferArena::~BufferArena()
+    {
+        release();
+    }
+
+    void BufferArena::init()
+    {
+        GLint storageAlignment = 0;
+        GLint uniformAlignment = 0;
+        glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+        size_t alignment = 16;
+        alignment = std::max(alignment, static_cast<size_t>(storageAlignment));
+        alignment = std::max(alignment, static_cast<size_t>(uniformAlignment));
+        m_alignment = alignment;
+    }
+
+    BufferArena::Allocation BufferArena::allocate(size_t numBytes)
+    {
+        Allocation allocation;
+        if (numBytes == 0) return allocation;
+        if (numBytes % m_alignment != 0) numBytes += m_alignment - (numBytes % m_alignment);
+        for (size_t i = 0; i < m_blocks.size(); ++i)
+        {
+            if (allocateFrom(i, numBytes, allocation)) return allocation;
+        }
+        Block block;
+        block.size = std::max(m_blockSize, numBytes);
+        if (block.size % m_alignment != 0) block.size += m_alignment - (block.size % m_alignment);
+        block.generation = ++m_generation;
+        glGenBuffers(1, &block.buffer);
+        glBindBuffer(m_target, block.buffer);
+        glBufferData(m_target, block.size, NULL, m_usage);
+        block.free[0] = block.size;
+        m_blocks.push_back(block);
+        if (!allocateFrom(m_blocks.size() - 1, numBytes, allocation))
+        {
+            throw std::runtime_error("BufferArena: could not allocate from new block");
+        }
+        return allocation;
+    }
+
+    bool BufferArena::allocateFrom(size_t blockIdx, size_t numBytes, Allocation& allocation)
+    {
+        Block& block = m_blocks[blockIdx];
+        for (auto it = block.free.begin(); it != block.free.end(); ++it)
+        {
+            if (it->second < numBytes) continue;
+            size_t offset = it->first;
+            size_t remaining = it->second - numBytes;
+            block.free.erase(it);
+            if (remaining > 0) block.free[offset + numBytes] = remaining;
+            ++block.numAllocations;
+            allocation.buffer = block.buffer;
+            allocation.block = blockIdx;
+            allocation.offset = offset;
+            allocation.size = numBytes;
+            allocation.generation = block.generation;
+            return true;
+        }
+        return false;
+    }
+
+    void BufferArena::free(Allocation& allocation)
+    {
+        if (!isCurrent(allocation))
+        {
+            // its block was deleted by release() or trim()
+            allocation = Allocation();
+            return;
+        }
+        Block& block = m_blocks[allocation.block];
+        size_t offset = allocation.offset;
+        size_t size = allocation.size;
+        // merge with the free neighbours
+        auto next = block.free.lower_bound(offset);
+        if ((next != block.free.end()) && (next->first == offset + size))
+        {
+            size += next->second;
+            next = block.free.erase(next);
+        }
+        if (next != block.free.begin())
+        {
+            auto prev = std::prev(next);
+            if (prev->first + prev->second == offset)
+            {
+                offset = prev->first;
+                size += prev->second;
+                block.free.erase(prev);
+            }
+        }
+        block.free[offset] = size;
+        --block.numAllocations;
+        allocation = Allocation();
+    }
+
+    bool BufferArena::isCurrent(const Allocation& allocation) const
+    {
+        return allocation.valid()
+            && (allocation.block < m_blocks.size())
+            && (m_blocks[allocation.block].generation == allocation.generation)
+            && (m_blocks[allocation.block].buffer == allocation.buffer);
+    }
+
+    void BufferArena::trim()
+    {
+        // only trailing blocks can go, allocations refer to blocks by index
+        while (!m_blocks.empty() && (m_blocks.back().numAllocations == 0))
+        {
+            glDeleteBuffers(1, &m_blocks.back().buffer);
+            m_blocks.pop_back();
+        }
+    }
+
+    void BufferArena::release()
+    {
+        for (Block& block : m_blocks)
+        {
+            if (block.buffer != 0) glDeleteBuffers(1, &block.buffer);
+        }
+        m_blocks.clear();
+    }
+
+    BufferArena::Statistics BufferArena::statistics() const
+    {
+        Statistics stats;
+        stats.numBlocks = m_blocks.size();
+        for (const Block& block : m_blocks)
+        {
+            stats.numAllocations += block.numAllocations;
+            stats.bytesReserved += block.size;
+            stats.numFreeRanges += block.free.size();
+            for (const auto& range : block.free)
+            {
+                stats.bytesFree += range.second;
+                stats.largestFreeRange = std::max(stats.largestFreeRange, range.second);
+            }
+        }
+        stats.bytesAllocated = stats.bytesReserved - stats.bytesFree;
+        return stats;
+    }
+
+    void BufferArena::drawImGui() const
+    {
+        Statistics stats = statistics();
+        ImGui::Text("blocks %zu, allocations %zu", stats.numBlocks, stats.numAllocations);
+        ImGui::Text("allocated %.2f / %.2f MiB", stats.bytesAllocated / (1024.0 * 1024.0), stats.bytesReserved / (1024.0 * 1024.0));
+        ImGui::Text("free ranges %zu, largest %.2f MiB", stats.numFreeRanges, stats.largestFreeRange / (1024.0 * 1024.0));
+        ImGui::Text("fragmentation %.3f", stats.fragmentation());
+    }
+
+} // namespace gl_classes
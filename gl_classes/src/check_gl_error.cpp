@@ -1,17 +1,87 @@
 #include "gl_classes/imgui_gl.h"
 #include "gl_classes/check_gl_error.h"
+#include "gl_classes/debug_message_log.h"
+#include <atomic>
 #include <iostream>
+#include <mutex>
+#include <set>
+#include <vector>
 
 namespace gl_classes {
 
+    namespace {
+#ifdef NDEBUG
+        ErrorCheckPolicy policy = ErrorCheckPolicy::PerFrame;
+#else
+        ErrorCheckPolicy policy = ErrorCheckPolicy::PerCall;
+#endif
+        // interned names are never freed, so the asynchronous debug callback
+        // can read the current one while another thread publishes the next
+        std::mutex contextMutex;
+        std::set<std::string> contextNames;
+        std::atomic<const char*> context("");
+    } // namespace
+
+    ErrorCheckPolicy errorCheckPolicy()
+    {
+        return policy;
+    }
+
+    void errorCheckPolicy(ErrorCheckPolicy value)
+    {
+        policy = value;
+        if (DebugMessageLog::active() != nullptr)
+        {
+            if (policy == ErrorCheckPolicy::PerCall) glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+            else glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+        }
+    }
+
+    const char* errorContext()
+    {
+        return context.load(std::memory_order_acquire);
+    }
+
+    void errorContext(const std::string& name)
+    {
+        if (name == context.load(std::memory_order_relaxed)) return;
+        std::lock_guard<std::mutex> lock(contextMutex);
+        const char* interned = contextNames.insert(name).first->c_str();
+        context.store(interned, std::memory_order_release);
+    }
+
     void checkGLError()
+    {
+        if (policy == ErrorCheckPolicy::PerCall) checkGLErrorNow();
+    }
+
+    void checkGLErrorFrame()
+    {
+        if (policy != ErrorCheckPolicy::Off) checkGLErrorNow();
+    }
+
+    void checkGLErrorNow()
     {
         GLenum err;
         bool hasError = false;
         while ((err = glGetError()) != GL_NO_ERROR) {
             std::cout << err;
+            const char* name = errorContext();
+            if (name[0] != '\0') std::cout << " in " << name;
+            std::cout << std::endl;
             hasError = true;
         }
+        DebugMessageLog* log = DebugMessageLog::active();
+        if (log != nullptr)
+        {
+            std::vector<DebugMessageLog::Message> messages;
+            log->drain(messages);
+            for (const auto& message : messages)
+            {
+                std::cout << DebugMessageLog::Format(message) << std::endl;
+                hasError = hasError || message.isError();
+            }
+        }
         if (hasError)
             throw std::runtime_error("Open GL Error");
     }
@@ -0,0 +1,128 @@
+#include "gl_classes/compute_pipeline.h"
+#include "gl_classes/gpu_profiler.h"
+#include "gl_classes/check_gl_error.h"
+
+namespace gl_classes {
+
+    namespace {
+        // only writes from shaders are incoherent and need a barrier before use
+        const GLbitfield shaderWriteUsage = GL_SHADER_STORAGE_BARRIER_BIT | GL_ATOMIC_COUNTER_BARRIER_BIT;
+    } // namespace
+
+    ComputePipeline::Stage& ComputePipeline::add(const std::string& name, std::function<void()> run)
+    {
+        m_stages.push_back(Stage(name, run));
+        return m_stages.back();
+    }
+
+    void ComputePipeline::run()
+    {
+        for (Stage& stage : m_stages)
+        {
+            // barrier bits for buffers written by earlier stages
+            GLbitfield bits = 0;
+            for (const Access& access : stage.m_accesses)
+            {
+                auto it = m_written.find(access.buffer());
+                if (it != m_written.end())
+                {
+                    bits |= access.usage & ~it->second;
+                }
+            }
+            barrier(bits);
+
+            for (const Access& access : stage.m_accesses)
+            {
+                if (access.target == GL_NONE) continue;
+                BufferRange range = access.range();
+                auto it = m_bindings.find(std::make_pair(access.target, access.binding));
+                if ((it != m_bindings.end()) && (it->second == range))
+                {
+                    ++m_statistics.skippedBindings;
+                    continue;
+                }
+                if ((range.offset == 0) && (range.size == 0))
+                {
+                    glBindBufferBase(access.target, access.binding, range.buffer);
+                }
+                else
+                {
+                    GLsizeiptr size = static_cast<GLsizeiptr>(range.size);
+                    if (size == 0)
+                    {
+                        // offset without a range, bind up to the end of the buffer
+                        GLint64 bufferSize = 0;
+                        glBindBuffer(GL_COPY_READ_BUFFER, range.buffer);
+                        glGetBufferParameteri64v(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &bufferSize);
+                        size = static_cast<GLsizeiptr>(bufferSize) - static_cast<GLsizeiptr>(range.offset);
+                    }
+                    glBindBufferRange(access.target, access.binding, range.buffer, range.offset, size);
+                }
+                m_bindings[std::make_pair(access.target, access.binding)] = range;
+                ++m_statistics.bindings;
+            }
+
+            {
+                GpuProfiler::Scope scope(stage.m_name);
+                errorContext(stage.m_name);
+                stage.m_run();
+            }
+
+            for (const Access& access : stage.m_accesses)
+            {
+                if (!access.write) continue;
+                if (access.usage & shaderWriteUsage) m_written[access.buffer()] = 0;
+                else m_written.erase(access.buffer());
+            }
+            for (const auto& binding : stage.m_clobbers)
+            {
+                m_bindings.erase(binding);
+            }
+        }
+        ++m_statistics.runs;
+        checkGLError();
+    }
+
+    void ComputePipeline::finish(GLbitfield usage)
+    {
+        GLbitfield bits = 0;
+        for (const auto& item : m_written)
+        {
+            bits |= usage & ~item.second;
+        }
+        barrier(bits);
+    }
+
+    void ComputePipeline::invalidateBindings()
+    {
+        m_bindings.clear();
+    }
+
+    ComputePipeline::Usage ComputePipeline::UsageOf(GLenum target)
+    {
+        switch (target)
+        {
+        case GL_UNIFORM_BUFFER:          return Uniform;
+        case GL_ATOMIC_COUNTER_BUFFER:   return AtomicCounter;
+        case GL_ARRAY_BUFFER:            return VertexAttrib;
+        case GL_ELEMENT_ARRAY_BUFFER:    return ElementArray;
+        case GL_DISPATCH_INDIRECT_BUFFER:
+        case GL_DRAW_INDIRECT_BUFFER:    return Command;
+        case GL_SHADER_STORAGE_BUFFER:
+        default:                         return ShaderStorage;
+        }
+    }
+
+    void ComputePipeline::barrier(GLbitfield bits)
+    {
+        if (bits == 0) return;
+        glMemoryBarrier(bits);
+        ++m_statistics.barriers;
+        // the barrier covers all writes issued so far
+        for (auto& item : m_written)
+        {
+            item.second |= bits;
+        }
+    }
+
+} // namespace gl_classes
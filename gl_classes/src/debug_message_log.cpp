@@ -0,0 +1,182 @@
+#include "gl_classes/debug_message_log.h"
+#include "gl_classes/check_gl_error.h"
+#include "gl_classes/has_extension.h"
+#include <sstream>
+#include <cstring>
+#include <algorithm>
+
+namespace gl_classes {
+
+    namespace {
+        DebugMessageLog* activeLog = nullptr;
+
+        const char* sourceString(GLenum source)
+        {
+            switch (source)
+            {
+            case GL_DEBUG_SOURCE_API:             return "api";
+            case GL_DEBUG_SOURCE_WINDOW_SYSTEM:   return "window system";
+            case GL_DEBUG_SOURCE_SHADER_COMPILER: return "shader compiler";
+            case GL_DEBUG_SOURCE_THIRD_PARTY:     return "third party";
+            case GL_DEBUG_SOURCE_APPLICATION:     return "application";
+            default:                              return "other";
+            }
+        }
+
+        const char* typeString(GLenum type)
+        {
+            switch (type)
+            {
+            case GL_DEBUG_TYPE_ERROR:               return "error";
+            case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "deprecated";
+            case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:  return "undefined behavior";
+            case GL_DEBUG_TYPE_PORTABILITY:         return "portability";
+            case GL_DEBUG_TYPE_PERFORMANCE:         return "performance";
+            default:                                return "other";
+            }
+        }
+    } // namespace
+
+    DebugMessageLog::DebugMessageLog(size_t capacity)
+        : m_slots(std::max<size_t>(capacity, 1))
+        , m_write(0)
+        , m_read(0)
+        , m_dropped(0)
+        , m_installed(false)
+    {
+        for (size_t i = 0; i < m_slots.size(); ++i)
+        {
+            m_slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    DebugMessageLog::~DebugMessageLog()
+    {
+        uninstall();
+    }
+
+    bool DebugMessageLog::install(GLenum minSeverity)
+    {
+        if (!Supported()) return false;
+        glEnable(GL_DEBUG_OUTPUT);
+        glDebugMessageCallback(&DebugMessageLog::Callback, this);
+        glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_TRUE);
+        const GLenum severities[] = {
+            GL_DEBUG_SEVERITY_NOTIFICATION, GL_DEBUG_SEVERITY_LOW,
+            GL_DEBUG_SEVERITY_MEDIUM, GL_DEBUG_SEVERITY_HIGH
+        };
+        for (GLenum severity : severities)
+        {
+            if (severity == minSeverity) break;
+            glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, severity, 0, nullptr, GL_FALSE);
+        }
+        m_installed = true;
+        active(this);
+        // reapply the policy for the synchronous flag
+        errorCheckPolicy(errorCheckPolicy());
+        return true;
+    }
+
+    void DebugMessageLog::uninstall()
+    {
+        if (!m_installed) return;
+        glDebugMessageCallback(nullptr, nullptr);
+        glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+        glDisable(GL_DEBUG_OUTPUT);
+        m_installed = false;
+        if (activeLog == this) activeLog = nullptr;
+    }
+
+    size_t DebugMessageLog::drain(std::vector<Message>& messages)
+    {
+        // single consumer, the gl thread
+        size_t count = 0;
+        uint64_t pos = m_read.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Slot& slot = m_slots[pos % m_slots.size()];
+            if (slot.sequence.load(std::memory_order_acquire) != pos + 1) break;
+            messages.push_back(slot.message);
+            slot.sequence.store(pos + m_slots.size(), std::memory_order_release);
+            ++pos;
+            ++count;
+        }
+        m_read.store(pos, std::memory_order_relaxed);
+        return count;
+    }
+
+    std::string DebugMessageLog::Format(const Message& message)
+    {
+        std::stringstream ss;
+        ss << "[" << sourceString(message.source) << " " << typeString(message.type) << " " << message.id << "]";
+        if (message.context[0] != '\0') ss << " in " << message.context;
+        ss << ": " << message.text;
+        return ss.str();
+    }
+
+    bool DebugMessageLog::Supported()
+    {
+        GLint major = 0;
+        GLint minor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+        return (major > 4) || (major == 4 && minor >= 3) || hasExtension("GL_KHR_debug");
+    }
+
+    DebugMessageLog* DebugMessageLog::active()
+    {
+        return activeLog;
+    }
+
+    void DebugMessageLog::active(DebugMessageLog* log)
+    {
+        activeLog = log;
+    }
+
+    void DebugMessageLog::push(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* text)
+    {
+        // bounded multi producer ring, each slot sequence tells whether it is free
+        uint64_t pos = m_write.load(std::memory_order_relaxed);
+        Slot* slot = nullptr;
+        while (true)
+        {
+            slot = &m_slots[pos % m_slots.size()];
+            uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+            int64_t diff = static_cast<int64_t>(sequence) - static_cast<int64_t>(pos);
+            if (diff == 0)
+            {
+                if (m_write.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            }
+            else if (diff < 0)
+            {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            else
+            {
+                pos = m_write.load(std::memory_order_relaxed);
+            }
+        }
+        Message& message = slot->message;
+        message.source = source;
+        message.type = type;
+        message.id = id;
+        message.severity = severity;
+        std::strncpy(message.context, errorContext(), sizeof(message.context) - 1);
+        message.context[sizeof(message.context) - 1] = '\0';
+        size_t textLength = (length < 0) ? std::strlen(text) : static_cast<size_t>(length);
+        textLength = std::min(textLength, sizeof(message.text) - 1);
+        std::memcpy(message.text, text, textLength);
+        message.text[textLength] = '\0';
+        slot->sequence.store(pos + 1, std::memory_order_release);
+    }
+
+    void GLAPIENTRY DebugMessageLog::Callback(
+        GLenum source, GLenum type, GLuint id, GLenum severity,
+        GLsizei length, const GLchar* message, const void* userParam)
+    {
+        DebugMessageLog* log = static_cast<DebugMessageLog*>(const_cast<void*>(userParam));
+        log->push(source, type, id, severity, length, message);
+    }
+
+} // namespace gl_classes
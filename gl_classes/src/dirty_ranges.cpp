@@ -0,0 +1,44 @@
+#include "gl_classes/dirty_ranges.h"
+#include <iterator>
+
+namespace gl_classes {
+
+    void DirtyRanges::add(size_t start, size_t num)
+    {
+        if (num == 0) return;
+        size_t end = start + num;
+        // first range that could touch [start - gap, end + gap)
+        auto it = m_ranges.upper_bound(start);
+        if (it != m_ranges.begin())
+        {
+            auto prev = std::prev(it);
+            if (prev->second + m_mergeGap >= start) it = prev;
+        }
+        while ((it != m_ranges.end()) && (it->first <= end + m_mergeGap))
+        {
+            if (it->first < start) start = it->first;
+            if (it->second > end) end = it->second;
+            it = m_ranges.erase(it);
+        }
+        m_ranges[start] = end;
+    }
+
+    void DirtyRanges::truncate(size_t size)
+    {
+        auto it = m_ranges.lower_bound(size);
+        m_ranges.erase(it, m_ranges.end());
+        if (!m_ranges.empty())
+        {
+            auto last = std::prev(m_ranges.end());
+            if (last->second > size) last->second = size;
+        }
+    }
+
+    size_t DirtyRanges::numItems() const
+    {
+        size_t count = 0;
+        for (const auto& range : m_ranges) count += range.second - range.first;
+        return count;
+    }
+
+} // namespace gl_classes
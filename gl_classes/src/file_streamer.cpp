@@ -0,0 +1,256 @@
+#include "gl_classes/file_streamer.h"
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace gl_classes {
+
+#ifdef _WIN32
+
+    void MappedFile::open(const std::string& path)
+    {
+        close();
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            throw std::runtime_error("MappedFile could not open " + path);
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size))
+        {
+            CloseHandle(file);
+            throw std::runtime_error("MappedFile could not stat " + path);
+        }
+        m_file = file;
+        m_size = static_cast<size_t>(size.QuadPart);
+        m_open = true;
+        if (m_size == 0) return;
+        m_mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        void* data = (m_mapping != NULL) ? MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+        if (data == NULL)
+        {
+            close();
+            throw std::runtime_error("MappedFile could not map " + path);
+        }
+        m_data = static_cast<const uint8_t*>(data);
+    }
+
+    void MappedFile::close()
+    {
+        if (m_data != nullptr) UnmapViewOfFile(m_data);
+        if (m_mapping != nullptr) CloseHandle(m_mapping);
+        if (m_file != nullptr) CloseHandle(m_file);
+        m_data = nullptr;
+        m_mapping = nullptr;
+        m_file = nullptr;
+        m_size = 0;
+        m_open = false;
+    }
+
+    // FILE_FLAG_SEQUENTIAL_SCAN already reads ahead
+    void MappedFile::willNeed(size_t start, size_t num) const {}
+    void MappedFile::dontNeed(size_t start, size_t num) const {}
+
+#else
+
+    void MappedFile::open(const std::string& path)
+    {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            throw std::runtime_error("MappedFile could not open " + path);
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0)
+        {
+            ::close(fd);
+            throw std::runtime_error("MappedFile could not stat " + path);
+        }
+        m_fd = fd;
+        m_size = static_cast<size_t>(info.st_size);
+        m_open = true;
+        if (m_size == 0) return;
+        void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            close();
+            throw std::runtime_error("MappedFile could not map " + path);
+        }
+        m_data = static_cast<const uint8_t*>(data);
+        madvise(data, m_size, MADV_SEQUENTIAL);
+    }
+
+    void MappedFile::close()
+    {
+        if (m_data != nullptr) munmap(const_cast<uint8_t*>(m_data), m_size);
+        if (m_fd >= 0) ::close(m_fd);
+        m_data = nullptr;
+        m_fd = -1;
+        m_size = 0;
+        m_open = false;
+    }
+
+    static void adviseRange(const uint8_t* data, size_t size, size_t start, size_t num, int advice)
+    {
+        if ((data == nullptr) || (start >= size)) return;
+        if (num > size - start) num = size - start;
+        // madvise needs page aligned addresses
+        static const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size_t begin = start - start % pageSize;
+        madvise(const_cast<uint8_t*>(data) + begin, start + num - begin, advice);
+    }
+
+    void MappedFile::willNeed(size_t start, size_t num) const
+    {
+        adviseRange(m_data, m_size, start, num, MADV_WILLNEED);
+    }
+
+    void MappedFile::dontNeed(size_t start, size_t num) const
+    {
+        adviseRange(m_data, m_size, start, num, MADV_DONTNEED);
+    }
+
+#endif
+
+    FileStreamer::FileStreamer(size_t chunkSize, size_t numStaging)
+        : m_chunkSize(chunkSize)
+        , m_numStaging(numStaging)
+    {
+        if ((m_chunkSize == 0) || (m_numStaging == 0))
+        {
+            throw std::invalid_argument("FileStreamer needs a chunk size and staging buffers");
+        }
+    }
+
+    FileStreamer::~FileStreamer()
+    {
+        for (Staging& staging : m_staging)
+        {
+            if (staging.fence != 0) glDeleteSync(staging.fence);
+            glBindBuffer(GL_COPY_READ_BUFFER, staging.buffer);
+            glUnmapBuffer(GL_COPY_READ_BUFFER);
+            glDeleteBuffers(1, &staging.buffer);
+        }
+    }
+
+    void FileStreamer::init()
+    {
+        if (!m_staging.empty()) return;
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        m_staging.resize(m_numStaging);
+        for (Staging& staging : m_staging)
+        {
+            glGenBuffers(1, &staging.buffer);
+            glBindBuffer(GL_COPY_READ_BUFFER, staging.buffer);
+            glBufferStorage(GL_COPY_READ_BUFFER, m_chunkSize, NULL, flags);
+            staging.mapped = static_cast<uint8_t*>(glMapBufferRange(GL_COPY_READ_BUFFER, 0, m_chunkSize, flags));
+            if (staging.mapped == nullptr)
+            {
+                throw std::runtime_error("FileStreamer could not map staging buffer");
+            }
+        }
+    }
+
+    bool FileStreamer::wait(Staging& staging, bool block)
+    {
+        if (staging.fence == 0) return false;
+        GLenum result = glClientWaitSync(staging.fence, 0, 0);
+        bool waited = false;
+        if (result == GL_TIMEOUT_EXPIRED)
+        {
+            if (!block) return false;
+            waited = true;
+            do
+            {
+                result = glClientWaitSync(staging.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000); // 1s
+            }
+            while (result == GL_TIMEOUT_EXPIRED);
+        }
+        glDeleteSync(staging.fence);
+        staging.fence = 0;
+        if (result == GL_WAIT_FAILED)
+        {
+            throw std::runtime_error("glClientWaitSync failed");
+        }
+        return waited;
+    }
+
+    FileStreamer::Statistics FileStreamer::stream(const std::string& path, GLuint buffer, size_t bufferOffset, size_t fileOffset, size_t numBytes)
+    {
+        MappedFile file(path);
+        return stream(file, buffer, bufferOffset, fileOffset, numBytes);
+    }
+
+    FileStreamer::Statistics FileStreamer::stream(const MappedFile& file, GLuint buffer, size_t bufferOffset, size_t fileOffset, size_t numBytes)
+    {
+        if (fileOffset > file.size())
+        {
+            throw std::out_of_range("FileStreamer offset beyond end of file");
+        }
+        if ((numBytes == npos) || (numBytes > file.size() - fileOffset))
+        {
+            numBytes = file.size() - fileOffset;
+        }
+        Statistics stats;
+        if (numBytes == 0) return stats;
+        init();
+        auto start = std::chrono::steady_clock::now();
+
+        file.willNeed(fileOffset, m_chunkSize);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        size_t slot = 0;
+        for (size_t done = 0; done < numBytes; done += m_chunkSize)
+        {
+            size_t chunk = (numBytes - done < m_chunkSize) ? (numBytes - done) : m_chunkSize;
+            size_t position = fileOffset + done;
+            // let the system read the next chunk while this one is copied
+            file.willNeed(position + chunk, m_chunkSize);
+
+            Staging& staging = m_staging[slot];
+            if (wait(staging, true)) ++stats.waits;
+            std::memcpy(staging.mapped, file.data() + position, chunk);
+            file.dontNeed(position, chunk);
+
+            glBindBuffer(GL_COPY_READ_BUFFER, staging.buffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, bufferOffset + done, chunk);
+            staging.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            // make sure the copy starts while the next chunk is read
+            glFlush();
+
+            ++stats.chunks;
+            slot = (slot + 1) % m_staging.size();
+        }
+        // the last copy finishes last, waiting on it includes the transfer
+        // in the measured time and leaves all staging buffers free
+        for (Staging& staging : m_staging) wait(staging, true);
+
+        stats.bytes = numBytes;
+        stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        m_total.bytes += stats.bytes;
+        m_total.chunks += stats.chunks;
+        m_total.waits += stats.waits;
+        m_total.seconds += stats.seconds;
+        return stats;
+    }
+
+    void FileStreamer::drawImGui() const
+    {
+        ImGui::Text("chunks %zu x %.2f MiB", m_numStaging, m_chunkSize / (1024.0 * 1024.0));
+        ImGui::Text("streamed %.2f MB in %.3f s, %.1f MB/s", m_total.bytes / 1e6, m_total.seconds, m_total.mbPerSecond());
+        ImGui::Text("chunks %llu, waits %llu", static_cast<unsigned long long>(m_total.chunks), static_cast<unsigned long long>(m_total.waits));
+    }
+
+} // namespace gl_classes
@@ -0,0 +1,197 @@
+#include "gl_classes/gpu_profiler.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace gl_classes {
+
+    namespace {
+        GpuProfiler* activeProfiler = nullptr;
+    } // namespace
+
+    GpuProfiler::GpuProfiler(uint32_t latency, size_t historySize)
+        : m_latency(latency)
+        , m_historySize(historySize)
+        , m_frame(0)
+    {}
+
+    GpuProfiler::~GpuProfiler()
+    {
+        if (activeProfiler == this) activeProfiler = nullptr;
+        if (!m_queries.empty())
+        {
+            glDeleteQueries(static_cast<GLsizei>(m_queries.size()), m_queries.data());
+        }
+    }
+
+    void GpuProfiler::begin(const std::string& name)
+    {
+        Pending scope;
+        scope.name = name;
+        scope.begin = acquireQuery();
+        scope.end = 0;
+        scope.frame = m_frame;
+        glQueryCounter(scope.begin, GL_TIMESTAMP);
+        m_open.push_back(scope);
+    }
+
+    void GpuProfiler::end()
+    {
+        if (m_open.empty())
+        {
+            throw std::runtime_error("GpuProfiler::end without begin");
+        }
+        Pending scope = m_open.back();
+        m_open.pop_back();
+        scope.end = acquireQuery();
+        glQueryCounter(scope.end, GL_TIMESTAMP);
+        m_pending.push_back(scope);
+    }
+
+    void GpuProfiler::frame()
+    {
+        // pending scopes are ordered by end query, results become available in order
+        while (!m_pending.empty())
+        {
+            const Pending& scope = m_pending.front();
+            if (scope.frame + m_latency > m_frame) break;
+            GLint available = GL_FALSE;
+            glGetQueryObjectiv(scope.end, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available == GL_FALSE) break;
+            GLuint64 start = 0;
+            GLuint64 stop = 0;
+            glGetQueryObjectui64v(scope.begin, GL_QUERY_RESULT, &start);
+            glGetQueryObjectui64v(scope.end, GL_QUERY_RESULT, &stop);
+            record(scope.name, (stop > start) ? (stop - start) * 1e-6 : 0.0);
+            releaseQuery(scope.begin);
+            releaseQuery(scope.end);
+            m_pending.pop_front();
+        }
+        ++m_frame;
+    }
+
+    void GpuProfiler::drawImGui(const char* title)
+    {
+        updateStatistics();
+        if (ImGui::Begin(title))
+        {
+            ImGui::Text("queries %zu, pending %zu", m_queries.size(), m_pending.size());
+            for (auto& item : m_statistics)
+            {
+                const Statistics& stats = item.second;
+                if (ImGui::TreeNode(item.first.c_str(), "%s  %.3f ms", item.first.c_str(), stats.mean))
+                {
+                    ImGui::Text("count %llu", static_cast<unsigned long long>(stats.count));
+                    ImGui::Text("last  %.3f ms", stats.last);
+                    ImGui::Text("min   %.3f ms", stats.min);
+                    ImGui::Text("mean  %.3f ms", stats.mean);
+                    ImGui::Text("p99   %.3f ms", stats.p99);
+                    ImGui::Text("max   %.3f ms", stats.max);
+                    if (!stats.history.empty())
+                    {
+                        ImGui::PlotLines(
+                            "ms", stats.history.data(), static_cast<int>(stats.history.size()),
+                            0, nullptr, 0.0f, static_cast<float>(stats.max), ImVec2(0, 60)
+                        );
+                    }
+                    ImGui::TreePop();
+                }
+            }
+            if (ImGui::Button("reset"))
+            {
+                resetStatistics();
+            }
+        }
+        ImGui::End();
+    }
+
+    void GpuProfiler::resetStatistics()
+    {
+        m_statistics.clear();
+        m_samples.clear();
+    }
+
+    GpuProfiler* GpuProfiler::active()
+    {
+        return activeProfiler;
+    }
+
+    void GpuProfiler::active(GpuProfiler* profiler)
+    {
+        activeProfiler = profiler;
+    }
+
+    GLuint GpuProfiler::acquireQuery()
+    {
+        if (m_freeQueries.empty())
+        {
+            GLuint query = 0;
+            glGenQueries(1, &query);
+            m_queries.push_back(query);
+            return query;
+        }
+        GLuint query = m_freeQueries.back();
+        m_freeQueries.pop_back();
+        return query;
+    }
+
+    void GpuProfiler::releaseQuery(GLuint query)
+    {
+        m_freeQueries.push_back(query);
+    }
+
+    void GpuProfiler::record(const std::string& name, double milliseconds)
+    {
+        Statistics& stats = m_statistics[name];
+        ++stats.count;
+        stats.last = milliseconds;
+
+        Series& series = m_samples[name];
+        float value = static_cast<float>(milliseconds);
+        if (series.samples.size() < m_historySize)
+        {
+            series.samples.push_back(value);
+        }
+        else if (!series.samples.empty())
+        {
+            series.samples[series.next] = value;
+            series.next = (series.next + 1) % series.samples.size();
+        }
+        series.changed = true;
+    }
+
+    void GpuProfiler::updateStatistics() const
+    {
+        for (auto& item : m_samples)
+        {
+            Series& series = item.second;
+            if (!series.changed) continue;
+            series.changed = false;
+            Statistics& stats = m_statistics[item.first];
+
+            // history in chronological order, starting at the oldest sample
+            stats.history.assign(series.samples.begin() + series.next, series.samples.end());
+            stats.history.insert(stats.history.end(), series.samples.begin(), series.samples.begin() + series.next);
+            if (stats.history.size() > m_historySize)
+            {
+                // historySize was reduced
+                stats.history.erase(stats.history.begin(), stats.history.end() - m_historySize);
+                series.samples = stats.history;
+                series.next = 0;
+            }
+            if (stats.history.empty()) continue;
+
+            // min, mean, max and p99 over the history window
+            m_sorted.assign(stats.history.begin(), stats.history.end());
+            std::sort(m_sorted.begin(), m_sorted.end());
+            double sum = 0;
+            for (float value : m_sorted) sum += value;
+            stats.min = m_sorted.front();
+            stats.max = m_sorted.back();
+            stats.mean = sum / m_sorted.size();
+            // nearest rank
+            size_t rank = (m_sorted.size() * 99 + 99) / 100;
+            stats.p99 = m_sorted[rank - 1];
+        }
+    }
+
+} // namespace gl_classes
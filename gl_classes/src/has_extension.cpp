@@ -0,0 +1,21 @@
+#include "gl_classes/imgui_gl.h"
+#include "gl_classes/has_extension.h"
+
+namespace gl_classes {
+
+    bool hasExtension(const std::string& name)
+    {
+        GLint numExtensions = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+        for (GLint i = 0; i < numExtensions; ++i)
+        {
+            const GLubyte* extension = glGetStringi(GL_EXTENSIONS, i);
+            if ((extension != nullptr) && (name == reinterpret_cast<const char*>(extension)))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+} // namespace gl_classes
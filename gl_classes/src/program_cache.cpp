@@ -0,0 +1,155 @@
+#include "gl_classes/program_cache.h"
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+
+namespace gl_classes {
+
+    namespace {
+        const char cacheMagic[4] = {'G', 'L', 'P', 'B'};
+        ProgramCache* activeCache = nullptr;
+
+        std::string glString(GLenum name)
+        {
+            const GLubyte* str = glGetString(name);
+            return (str != nullptr) ? std::string(reinterpret_cast<const char*>(str)) : std::string();
+        }
+    } // namespace
+
+    ProgramCache::ProgramCache(const std::string& directory)
+        : m_directory(directory)
+    {}
+
+    bool ProgramCache::load(GLuint program, const std::string& key)
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::ifstream file(filename(key), std::ios::binary);
+        if (!file)
+        {
+            ++m_statistics.misses;
+            return false;
+        }
+        char magic[4];
+        uint64_t keySize = 0;
+        file.read(magic, sizeof(magic));
+        file.read(reinterpret_cast<char*>(&keySize), sizeof(keySize));
+        if (!file || !std::equal(magic, magic + sizeof(magic), cacheMagic) || (keySize != key.size()))
+        {
+            ++m_statistics.misses;
+            return false;
+        }
+        std::string storedKey(keySize, '\0');
+        file.read(&storedKey[0], keySize);
+        GLenum format = 0;
+        uint64_t binarySize = 0;
+        file.read(reinterpret_cast<char*>(&format), sizeof(format));
+        file.read(reinterpret_cast<char*>(&binarySize), sizeof(binarySize));
+        if (!file || (storedKey != key))
+        {
+            // hash collision or truncated file
+            ++m_statistics.misses;
+            return false;
+        }
+        std::vector<char> binary(binarySize);
+        file.read(binary.data(), binarySize);
+        if (!file)
+        {
+            ++m_statistics.misses;
+            return false;
+        }
+
+        glProgramBinary(program, format, binary.data(), static_cast<GLsizei>(binarySize));
+        GLint linked = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (linked != GL_TRUE)
+        {
+            ++m_statistics.rejected;
+            ++m_statistics.misses;
+            return false;
+        }
+        ++m_statistics.hits;
+        m_statistics.loadSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return true;
+    }
+
+    bool ProgramCache::store(GLuint program, const std::string& key)
+    {
+        GLint binarySize = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binarySize);
+        if (binarySize <= 0)
+        {
+            ++m_statistics.storeFailures;
+            return false;
+        }
+        std::vector<char> binary(binarySize);
+        GLenum format = 0;
+        GLsizei length = 0;
+        glGetProgramBinary(program, binarySize, &length, &format, binary.data());
+
+        std::ofstream file(filename(key), std::ios::binary | std::ios::trunc);
+        uint64_t keySize = key.size();
+        uint64_t binaryLength = static_cast<uint64_t>(length);
+        file.write(cacheMagic, sizeof(cacheMagic));
+        file.write(reinterpret_cast<const char*>(&keySize), sizeof(keySize));
+        file.write(key.data(), keySize);
+        file.write(reinterpret_cast<const char*>(&format), sizeof(format));
+        file.write(reinterpret_cast<const char*>(&binaryLength), sizeof(binaryLength));
+        file.write(binary.data(), length);
+        if (!file)
+        {
+            ++m_statistics.storeFailures;
+            return false;
+        }
+        ++m_statistics.stores;
+        return true;
+    }
+
+    std::string ProgramCache::key(const std::vector<std::string>& codes)
+    {
+        std::ostringstream ss;
+        ss << driver() << '\n';
+        for (const auto& code : codes)
+        {
+            ss << code.size() << '\n' << code;
+        }
+        return ss.str();
+    }
+
+    bool ProgramCache::Supported()
+    {
+        GLint numFormats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+        return numFormats > 0;
+    }
+
+    ProgramCache* ProgramCache::active()
+    {
+        return activeCache;
+    }
+
+    void ProgramCache::active(ProgramCache* cache)
+    {
+        activeCache = cache;
+    }
+
+    std::string ProgramCache::filename(const std::string& key) const
+    {
+        std::ostringstream ss;
+        ss << m_directory << "/program_" << std::hex << std::setw(16) << std::setfill('0')
+           << static_cast<uint64_t>(std::hash<std::string>()(key)) << ".bin";
+        return ss.str();
+    }
+
+    const std::string& ProgramCache::driver()
+    {
+        if (m_driver.empty())
+        {
+            m_driver = glString(GL_VENDOR) + "|" + glString(GL_RENDERER) + "|" + glString(GL_VERSION);
+        }
+        return m_driver;
+    }
+
+} // namespace gl_classes
@@ -0,0 +1,137 @@
+#include "gl_classes/program_uniform.h"
+#include <vector>
+#include <algorithm>
+
+namespace gl_classes {
+
+    namespace {
+        bool deferred = false;
+        ProgramUniformBase::Statistics statistics;
+        std::vector<ProgramUniformBase*> dirtyUniforms;
+    } // namespace
+
+    ProgramUniformBase::ProgramUniformBase(const ProgramUniformBase& other)
+        : m_glProgram(other.m_glProgram)
+        , m_loc(other.m_loc)
+        , m_name(other.m_name)
+        , m_nameZeroed(other.m_nameZeroed)
+        , m_enableDebugOutput(other.m_enableDebugOutput)
+    {
+        // a copy does not know whether its value was uploaded, but keeps a
+        // pending deferred upload, the source may be destroyed before Flush
+        copyDirty(other);
+    }
+
+    ProgramUniformBase& ProgramUniformBase::operator=(const ProgramUniformBase& other)
+    {
+        if (this == &other) return *this;
+        invalidate();
+        m_glProgram = other.m_glProgram;
+        m_loc = other.m_loc;
+        m_name = other.m_name;
+        m_nameZeroed = other.m_nameZeroed;
+        m_enableDebugOutput = other.m_enableDebugOutput;
+        copyDirty(other);
+        return *this;
+    }
+
+    ProgramUniformBase::~ProgramUniformBase()
+    {
+        invalidate();
+    }
+
+    void ProgramUniformBase::flush()
+    {
+        if (!m_dirty) return;
+        dirtyUniforms.erase(std::remove(dirtyUniforms.begin(), dirtyUniforms.end(), this), dirtyUniforms.end());
+        m_dirty = false;
+        upload();
+        ++statistics.calls;
+    }
+
+    void ProgramUniformBase::Flush(GLuint glProgram)
+    {
+        // upload the uniforms of glProgram and keep the others in place
+        size_t numRemaining = 0;
+        for (ProgramUniformBase* uniform : dirtyUniforms)
+        {
+            if (uniform->m_glProgram != glProgram)
+            {
+                dirtyUniforms[numRemaining++] = uniform;
+                continue;
+            }
+            uniform->m_dirty = false;
+            uniform->upload();
+            ++statistics.calls;
+        }
+        dirtyUniforms.resize(numRemaining);
+    }
+
+    void ProgramUniformBase::FlushAll()
+    {
+        for (ProgramUniformBase* uniform : dirtyUniforms)
+        {
+            uniform->m_dirty = false;
+            uniform->upload();
+            ++statistics.calls;
+        }
+        dirtyUniforms.clear();
+    }
+
+    bool ProgramUniformBase::Deferred()
+    {
+        return deferred;
+    }
+
+    void ProgramUniformBase::Deferred(bool value)
+    {
+        if (deferred && !value) FlushAll();
+        deferred = value;
+    }
+
+    ProgramUniformBase::Statistics& ProgramUniformBase::GetStatistics()
+    {
+        return statistics;
+    }
+
+    void ProgramUniformBase::ResetStatistics()
+    {
+        statistics = Statistics();
+    }
+
+    void ProgramUniformBase::changed()
+    {
+        m_valid = true;
+        if (!deferred)
+        {
+            upload();
+            ++statistics.calls;
+            return;
+        }
+        if (m_dirty)
+        {
+            ++statistics.coalesced;
+            return;
+        }
+        m_dirty = true;
+        dirtyUniforms.push_back(this);
+    }
+
+    void ProgramUniformBase::copyDirty(const ProgramUniformBase& other)
+    {
+        if (!other.m_dirty || m_dirty) return;
+        m_dirty = true;
+        dirtyUniforms.push_back(this);
+    }
+
+    void ProgramUniformBase::invalidate()
+    {
+        if (m_dirty)
+        {
+            dirtyUniforms.erase(std::remove(dirtyUniforms.begin(), dirtyUniforms.end(), this), dirtyUniforms.end());
+            m_dirty = false;
+        }
+        m_valid = false;
+    }
+
+} // namespace gl_classes
@@ -6,11 +6,13 @@ namespace gl_classes {
 // https://stackoverflow.com/a/2548212
 std::string& replace_string_inplace(std::string& str, const std::string& remove, const std::string& insert) 
 {
+    // an empty remove matches everywhere and would never finish
+    if (remove.empty()) return str;
     std::string::size_type pos = 0;
     while ((pos = str.find(remove, pos)) != std::string::npos)
     {
         str.replace(pos, remove.size(), insert);
-        pos++;
+        pos += insert.size();
     }
 
     return str;
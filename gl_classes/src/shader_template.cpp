@@ -0,0 +1,125 @@
+#include "gl_classes/shader_template.h"
+#include "gl_classes/replace_string.h"
+#include <unordered_map>
+#include <mutex>
+
+namespace gl_classes {
+
+    namespace {
+        bool isKeyChar(char c)
+        {
+            return ((c >= 'A') && (c <= 'Z'))
+                || ((c >= 'a') && (c <= 'z'))
+                || ((c >= '0') && (c <= '9'))
+                || (c == '_');
+        }
+    } // namespace
+
+    ShaderTemplate::ShaderTemplate(const std::string& code)
+    {
+        parse(code);
+    }
+
+    void ShaderTemplate::parse(const std::string& code)
+    {
+        m_code = code;
+        m_segments.clear();
+        m_placeholders.clear();
+
+        size_t textBegin = 0;
+        size_t pos = 0;
+        while ((pos = m_code.find("##", pos)) != std::string::npos)
+        {
+            size_t keyEnd = pos + 2;
+            while ((keyEnd < m_code.size()) && isKeyChar(m_code[keyEnd])) ++keyEnd;
+            if ((keyEnd == pos + 2) || (m_code.compare(keyEnd, 2, "##") != 0))
+            {
+                // not a placeholder, for example glsl token pasting
+                pos += 2;
+                continue;
+            }
+            std::string placeholder = m_code.substr(pos, keyEnd + 2 - pos);
+            int index = -1;
+            for (size_t i = 0; i < m_placeholders.size(); ++i)
+            {
+                if (m_placeholders[i] == placeholder) index = static_cast<int>(i);
+            }
+            if (index < 0)
+            {
+                index = static_cast<int>(m_placeholders.size());
+                m_placeholders.push_back(placeholder);
+            }
+            m_segments.push_back({textBegin, pos - textBegin, index});
+            pos = keyEnd + 2;
+            textBegin = pos;
+        }
+        m_segments.push_back({textBegin, m_code.size() - textBegin, -1});
+    }
+
+    std::string ShaderTemplate::render(const Replacements& replacements) const
+    {
+        // resolve the value of each placeholder once
+        std::vector<const std::string*> values(m_placeholders.size(), nullptr);
+        for (size_t i = 0; i < m_placeholders.size(); ++i)
+        {
+            values[i] = &m_placeholders[i];
+            for (const auto& replacement : replacements)
+            {
+                if (replacement.first == m_placeholders[i]) values[i] = &replacement.second;
+            }
+        }
+
+        size_t size = 0;
+        for (const auto& segment : m_segments)
+        {
+            size += segment.length;
+            if (segment.placeholder >= 0) size += values[segment.placeholder]->size();
+        }
+        std::string result;
+        result.reserve(size);
+        for (const auto& segment : m_segments)
+        {
+            result.append(m_code, segment.begin, segment.length);
+            if (segment.placeholder >= 0) result.append(*values[segment.placeholder]);
+        }
+
+        // keys which are no placeholders are replaced the slow way
+        for (const auto& replacement : replacements)
+        {
+            if (!IsPlaceholder(replacement.first) && !replacement.first.empty())
+            {
+                replace_string_inplace(result, replacement.first, replacement.second);
+            }
+        }
+        return result;
+    }
+
+    std::shared_ptr<const ShaderTemplate> ShaderTemplate::Get(const std::string& code)
+    {
+        static std::mutex mutex;
+        static std::unordered_map<std::string, std::shared_ptr<const ShaderTemplate>> templates;
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = templates.find(code);
+        if (it != templates.end())
+        {
+            return it->second;
+        }
+        auto parsed = std::make_shared<const ShaderTemplate>(code);
+        templates.emplace(code, parsed);
+        return parsed;
+    }
+
+    bool ShaderTemplate::IsPlaceholder(const std::string& key)
+    {
+        if ((key.size() < 5) || (key.compare(0, 2, "##") != 0) || (key.compare(key.size() - 2, 2, "##") != 0))
+        {
+            return false;
+        }
+        for (size_t i = 2; i < key.size() - 2; ++i)
+        {
+            if (!isKeyChar(key[i])) return false;
+        }
+        return true;
+    }
+
+} // namespace gl_classes
@@ -5,6 +5,17 @@ add_library(
     STATIC 
     src/replace_string.cpp
     src/check_gl_error.cpp
+    src/has_extension.cpp
+    src/program_cache.cpp
+    src/shader_template.cpp
+    src/gpu_profiler.cpp
+    src/debug_message_log.cpp
+    src/compute_pipeline.cpp
+    src/program_uniform.cpp
+    src/buffer_arena.cpp
+    src/async_readback.cpp
+    src/dirty_ranges.cpp
+    src/file_streamer.cpp
 )
 
 target_link_libraries(${PROJECT_NAME} PUBLIC OpenGL::GL)
@@ -26,3 +37,12 @@ target_compile_options(
     -DGLM_FORCE_SWIZZLE 
     -DGLM_FORCE_INLINE 
 )
+
+# correctness tests and throughput benchmarks of the compute programs, they
+# need an OpenGL 4.5 context
+option(GL_CLASSES_BUILD_BENCHMARKS "Build the compute program tests and benchmarks" OFF)
+if(GL_CLASSES_BUILD_BENCHMARKS)
+    add_executable(gl_classes_benchmarks benchmarks/compute_benchmarks.cpp)
+    target_link_libraries(gl_classes_benchmarks PRIVATE ${PROJECT_NAME})
+    add_test(NAME gl_classes_compute_tests COMMAND gl_classes_benchmarks --test)
+endif()